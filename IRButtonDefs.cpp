@@ -1,9 +1,33 @@
 #include "IRButtonDefs.h"
+#include <string.h> // memmove()
 
+// Reads one command code from a flash or RAM table.
+static int buttonCode(const IrButton* button, bool inFlash) {
+#if IR_BUTTONS_IN_PROGMEM
+    if (inFlash) return pgm_read_word(&button->commandCode);
+#else
+    (void)inFlash;
+#endif
+    return button->commandCode;
+}
+
+const IrButton* findButton(const IrButton buttons[], size_t count, int commandCode, bool inFlash) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int midCode = buttonCode(&buttons[mid], inFlash);
+        if (midCode == commandCode) return &buttons[mid];
+        if (midCode < commandCode) low = mid + 1;
+        else high = mid;
+    }
+    return nullptr;
+}
+
+#if IR_LIB_ENABLE_SONY
 // --- Sceptre/Sony Button Definitions ---
 //Most of these were captured trial and error, but examples exist at http://www.hifi-remote.com/sony/Sony_tv.htm and http://www.johncon.com/john/archive/rawSend.Sceptre.ino
 //Sony codes commonly found online include the device address (0b00010000) and are obfuscated by being bit reversed (MSB first)
-const IrButton SCEPTRE_BUTTONS[] = {
+constexpr IrButton SCEPTRE_BUTTONS[] IR_BUTTON_PROGMEM = {
     {0, "sceptreOne"},
     {1, "sceptreTwo"},
     {2, "sceptreThree"},
@@ -55,12 +79,15 @@ const IrButton SCEPTRE_BUTTONS[] = {
     {123, "sceptreVoice"}        // toggle menu voice assist
 };
 const size_t SCEPTRE_BUTTONS_COUNT = sizeof(SCEPTRE_BUTTONS) / sizeof(IrButton);
+static_assert(irButtonsSorted(SCEPTRE_BUTTONS, SCEPTRE_BUTTONS_COUNT), "SCEPTRE_BUTTONS must be sorted by commandCode");
+#endif // IR_LIB_ENABLE_SONY
 
 
+#if IR_LIB_ENABLE_JVC
 // --- JVC Button Definitions ---
 //Most of these were captured trial and error, format information is at https://www.sbprojects.net/knowledge/ir/jvc.php
 //JVC codes commonly found online include the device address and are MSB first, only the data is included here and it is in LSB first order.
-const IrButton JVC_BUTTONS[] = {
+constexpr IrButton JVC_BUTTONS[] IR_BUTTON_PROGMEM = {
     {0, "jvcPwr"}, 
     {1, "jvcVol+"},
     {2, "jvcVol-"},
@@ -68,9 +95,12 @@ const IrButton JVC_BUTTONS[] = {
     // Add more JVC buttons here as needed
 };
 const size_t JVC_BUTTONS_COUNT = sizeof(JVC_BUTTONS) / sizeof(IrButton);
+static_assert(irButtonsSorted(JVC_BUTTONS, JVC_BUTTONS_COUNT), "JVC_BUTTONS must be sorted by commandCode");
+#endif // IR_LIB_ENABLE_JVC
 
+#if IR_LIB_ENABLE_NEC
 // --- NEC Button Definitions ---
-const IrButton NEC_BUTTONS[] = {
+constexpr IrButton NEC_BUTTONS[] IR_BUTTON_PROGMEM = {
     {0, "necPwr"}, 
     {16, "necPlay"},
     {19, "necStop"},
@@ -78,4 +108,77 @@ const IrButton NEC_BUTTONS[] = {
     // Add more JVC buttons here as needed
 };
 const size_t NEC_BUTTONS_COUNT = sizeof(NEC_BUTTONS) / sizeof(IrButton);
+static_assert(irButtonsSorted(NEC_BUTTONS, NEC_BUTTONS_COUNT), "NEC_BUTTONS must be sorted by commandCode");
+#endif // IR_LIB_ENABLE_NEC
+
+
+// --- Remote Registry ---
+// Starts with one wildcard remote per built-in table, in RemoteBrand order.
+static IrRemote s_remotes[IR_LIB_MAX_REMOTES] = {
+#if IR_LIB_ENABLE_JVC
+    { JVC, IR_ADDRESS_ANY, JVC_BUTTONS, JVC_BUTTONS_COUNT, IR_BUTTONS_IN_PROGMEM, "JVC" },
+#endif
+#if IR_LIB_ENABLE_SONY
+    { SONY, IR_ADDRESS_ANY, SCEPTRE_BUTTONS, SCEPTRE_BUTTONS_COUNT, IR_BUTTONS_IN_PROGMEM, "Sceptre" }, // Sceptre TVs use SIRC-12
+#endif
+#if IR_LIB_ENABLE_NEC
+    { NEC, IR_ADDRESS_ANY, NEC_BUTTONS, NEC_BUTTONS_COUNT, IR_BUTTONS_IN_PROGMEM, "NEC" },
+#endif
+};
+static size_t s_remoteCount = 0
+#if IR_LIB_ENABLE_JVC
+    + 1
+#endif
+#if IR_LIB_ENABLE_SONY
+    + 1
+#endif
+#if IR_LIB_ENABLE_NEC
+    + 1
+#endif
+    ;
+
+static int compareRemote(const IrRemote& remote, RemoteBrand brand, int address) {
+    if (remote.brand != brand) return (remote.brand < brand) ? -1 : 1;
+    if (remote.address != address) return (remote.address < address) ? -1 : 1;
+    return 0;
+}
+
+// Lower bound of (brand, address) in the registry.
+static size_t remoteIndex(RemoteBrand brand, int address) {
+    size_t low = 0, high = s_remoteCount;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (compareRemote(s_remotes[mid], brand, address) < 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+bool registerRemote(RemoteBrand brand, int address, const IrButton buttons[], size_t count,
+                    const char* name, bool inFlash) {
+    if (buttons == nullptr && count != 0) return false;
+    for (size_t i = 1; i < count; i++) { // Same rule as irButtonsSorted(), checked at run time
+        if (buttonCode(&buttons[i - 1], inFlash) >= buttonCode(&buttons[i], inFlash)) return false;
+    }
+    size_t index = remoteIndex(brand, address);
+    if (index == s_remoteCount || compareRemote(s_remotes[index], brand, address) != 0) {
+        if (s_remoteCount >= IR_LIB_MAX_REMOTES) return false;
+        memmove(&s_remotes[index + 1], &s_remotes[index], (s_remoteCount - index) * sizeof(IrRemote));
+        s_remoteCount++;
+    }
+    s_remotes[index] = { brand, address, buttons, count, inFlash, name };
+    return true;
+}
+
+const IrRemote* findRemote(RemoteBrand brand, int address) {
+    size_t index = remoteIndex(brand, address);
+    if (index < s_remoteCount && compareRemote(s_remotes[index], brand, address) == 0) {
+        return &s_remotes[index];
+    }
+    if (address == IR_ADDRESS_ANY) return nullptr;
+    return findRemote(brand, IR_ADDRESS_ANY);
+}
 
+size_t remoteCount() {
+    return s_remoteCount;
+}
@@ -2,18 +2,79 @@
 #define IR_BUTTON_DEFS_H
 
 #include <stddef.h> // For size_t
+#include <stdint.h>
+#include "IRProtocolDefs.h" // For the IR_LIB_ENABLE_<protocol> switches
 
+// Button tables live in flash. AVR and ESP8266 need PROGMEM and pgm_read_*() for that, other
+// cores map const data to flash by themselves.
+#if defined(__AVR__) || defined(ESP8266)
+#include <Arduino.h> // PROGMEM, pgm_read_word(), strncpy_P()
+#define IR_BUTTONS_IN_PROGMEM 1
+#define IR_BUTTON_PROGMEM PROGMEM
+#else
+#define IR_BUTTONS_IN_PROGMEM 0
+#define IR_BUTTON_PROGMEM
+#endif
+
+#ifndef IR_LIB_BUTTON_NAME_SIZE
+#define IR_LIB_BUTTON_NAME_SIZE 16 // Longest button name plus the terminator
+#endif
+
+#ifndef IR_LIB_MAX_REMOTES
+#if defined(__AVR__)
+#define IR_LIB_MAX_REMOTES 8 // Registry slots, built-in remotes included
+#else
+#define IR_LIB_MAX_REMOTES 32
+#endif
+#endif
+
+#define IR_ADDRESS_ANY -1 // Remote address that matches every decoded address
+
+// Names are stored inline so a table is one flash block without separate string literals.
+// Tables must be sorted by commandCode, which is checked at compile time. Codes are 0 to 0xFFFF,
+// so learned commands above 0xFF can be named as well.
 struct IrButton {
-    int commandCode;
-    const char* name;
+    uint16_t commandCode;
+    char name[IR_LIB_BUTTON_NAME_SIZE];
+};
+
+// One remote's button map. The registry is sorted by (brand, address); a lookup tries the
+// exact address first and then the brand's IR_ADDRESS_ANY entry.
+struct IrRemote {
+    RemoteBrand brand;
+    int address;             // Decoded address, or IR_ADDRESS_ANY
+    const IrButton* buttons; // Sorted by commandCode
+    size_t count;
+    bool inFlash;            // buttons are PROGMEM (only differs from RAM on AVR and ESP8266)
+    const char* name;        // Optional, in RAM
 };
 
+// Binary search of a sorted table. Returns the matching entry (in flash when inFlash) or nullptr.
+const IrButton* findButton(const IrButton buttons[], size_t count, int commandCode, bool inFlash = IR_BUTTONS_IN_PROGMEM);
+
+// Adds a remote, or replaces the one with the same brand and address. Fails when the
+// registry is full or the table is not sorted. The table must stay valid while registered.
+bool registerRemote(RemoteBrand brand, int address, const IrButton buttons[], size_t count,
+                    const char* name = nullptr, bool inFlash = IR_BUTTONS_IN_PROGMEM);
+// Binary search of the registry. Returns nullptr when neither the address nor a wildcard is registered.
+const IrRemote* findRemote(RemoteBrand brand, int address);
+size_t remoteCount();
+
+constexpr bool irButtonsSorted(const IrButton* buttons, size_t count) {
+    return count < 2 || (buttons[0].commandCode < buttons[1].commandCode && irButtonsSorted(buttons + 1, count - 1));
+}
+
+#if IR_LIB_ENABLE_SONY
 extern const IrButton SCEPTRE_BUTTONS[]; 
 extern const size_t SCEPTRE_BUTTONS_COUNT;
+#endif
+#if IR_LIB_ENABLE_JVC
 extern const IrButton JVC_BUTTONS[];
 extern const size_t JVC_BUTTONS_COUNT;
+#endif
+#if IR_LIB_ENABLE_NEC
 extern const IrButton NEC_BUTTONS[];
 extern const size_t NEC_BUTTONS_COUNT;
+#endif
 
 #endif // IR_BUTTON_DEFS_H
-
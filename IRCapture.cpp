@@ -0,0 +1,349 @@
+#include "IRReceiver.h"
+
+// --- Hardware Capture Backends ---
+// Selected with begin(pin, IR_CAPTURE_HW_TIMER). Edge timestamps are latched by a peripheral
+// instead of calling micros() from a pin ISR, so interrupt latency no longer skews the measured
+// durations. Every backend feeds the same ring through _pushTransition(), so analysis and
+// decoding are unchanged. Only one receiver can own the hardware capture at a time; other
+// receivers can still use IR_CAPTURE_PIN_INTERRUPT alongside it.
+
+struct IRHardwareCapture {
+    static IRReceiver* s_owner;
+    static bool claim(IRReceiver* receiver);
+    static void onEdge(uint32_t timeMicros, int newState);
+    static void onToggle(uint32_t timeMicros);
+    static void onReception();
+    static void onDropped(uint32_t edges);
+};
+
+IRReceiver* IRHardwareCapture::s_owner = nullptr;
+
+bool IRHardwareCapture::claim(IRReceiver* receiver) {
+    if (s_owner != nullptr && s_owner != receiver) {
+        Debug(DEBUG_GENERAL, "IRReceiver: Hardware capture is already used by another receiver.\n");
+        return false;
+    }
+    return true;
+}
+
+void IRAM_ATTR IRHardwareCapture::onEdge(uint32_t timeMicros, int newState) {
+    if (s_owner) {
+        bool burstStarted = (s_owner->m_rawHead == s_owner->m_rawTail);
+        s_owner->_pushTransition(timeMicros, newState);
+        s_owner->_notifyDecodeTaskFromISR(burstStarted);
+    }
+}
+
+// For peripherals that capture both edges without reporting the level: levels alternate.
+void IRAM_ATTR IRHardwareCapture::onToggle(uint32_t timeMicros) {
+    if (s_owner) {
+        bool burstStarted = (s_owner->m_rawHead == s_owner->m_rawTail);
+        s_owner->_pushTransition(timeMicros, s_owner->m_lastPinState == HIGH ? LOW : HIGH);
+        s_owner->_notifyDecodeTaskFromISR(burstStarted);
+    }
+}
+
+// For peripherals that hand over whole receptions from their interrupt: they are replayed into
+// the ring later by _pollHardwareCapture(), which the decode task runs once woken.
+void IRAM_ATTR IRHardwareCapture::onReception() {
+    if (s_owner) {
+        s_owner->_notifyDecodeTaskFromISR(true);
+    }
+}
+
+// For receptions a backend had to discard before they reached the ring.
+void IRAM_ATTR IRHardwareCapture::onDropped(uint32_t edges) {
+    if (s_owner) {
+        s_owner->m_edgesDropped = s_owner->m_edgesDropped + edges;
+    }
+}
+
+#if (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__)) && (F_CPU % 1000000UL == 0)
+// --- AVR: Timer1 Input Capture (ICP1) ---
+// ICP1 is hard-wired to digital pin 8 (PB0). Timer1 runs free at F_CPU/8; the edge select bit
+// is flipped after every capture. Each overflow adds 524288/MHz us to a 32-bit count kept with
+// its fraction, so timestamps are exact at any whole-MHz clock and wrap at 2^32 us like micros().
+// Timer1 is taken over, so PWM on pins 9/10 and libraries using Timer1 (Servo) are unavailable.
+static const uint8_t ICP1_PIN = 8;
+static const uint32_t ICP1_MHZ = F_CPU / 1000000UL;
+static const uint32_t ICP1_OVERFLOW_MICROS = 524288UL / ICP1_MHZ;   // 65536 ticks of 8 clocks
+static const uint32_t ICP1_OVERFLOW_FRACTION = 524288UL % ICP1_MHZ; // In 1/MHz us
+static_assert(ICP1_MHZ > 0, "ICP1 capture needs F_CPU of at least 1 MHz");
+static volatile uint32_t s_timer1Micros = 0;  // Time at the last overflow
+static volatile uint8_t s_timer1Fraction = 0; // Its fraction of a microsecond, in 1/MHz us
+
+ISR(TIMER1_OVF_vect) {
+    s_timer1Micros += ICP1_OVERFLOW_MICROS;
+    s_timer1Fraction += ICP1_OVERFLOW_FRACTION;
+    if (s_timer1Fraction >= ICP1_MHZ) {
+        s_timer1Fraction -= ICP1_MHZ;
+        s_timer1Micros++;
+    }
+}
+
+ISR(TIMER1_CAPT_vect) {
+    uint16_t captured = ICR1;
+    bool wasRisingEdge = (TCCR1B & _BV(ICES1)) != 0;
+    TCCR1B ^= _BV(ICES1); // Capture the opposite edge next
+    TIFR1 = _BV(ICF1);    // Changing ICES1 may raise a spurious capture flag
+
+    uint32_t baseMicros = s_timer1Micros;
+    uint32_t fraction = s_timer1Fraction;
+    if ((TIFR1 & _BV(TOV1)) && captured < 0x8000) {
+        baseMicros += ICP1_OVERFLOW_MICROS; // Overflow is pending and the capture happened after it
+        fraction += ICP1_OVERFLOW_FRACTION;
+    }
+    uint32_t elapsed = (fraction + (uint32_t)captured * 8) / ICP1_MHZ; // A shift at 16 MHz
+    IRHardwareCapture::onEdge(baseMicros + elapsed, wasRisingEdge ? HIGH : LOW);
+}
+
+bool IRReceiver::_attachHardwareCapture() {
+    if (!IRHardwareCapture::claim(this)) return false;
+    if (m_irPin != ICP1_PIN) {
+        Debug(DEBUG_GENERAL, "IRReceiver: ICP1 capture is only available on pin ", ICP1_PIN, ".\n");
+        return false;
+    }
+    IRHardwareCapture::s_owner = this;
+    uint8_t oldSREG = SREG;
+    cli();
+    TCCR1A = 0;
+    TCCR1B = _BV(ICNC1) | _BV(CS11);                    // Noise canceler, clk/8, normal mode
+    if (m_lastPinState == LOW) TCCR1B |= _BV(ICES1);   // Next edge ends the current mark
+    TCNT1 = 0;
+    s_timer1Micros = 0;
+    s_timer1Fraction = 0;
+    TIFR1 = _BV(ICF1) | _BV(TOV1);
+    TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+    SREG = oldSREG;
+    return true;
+}
+
+void IRReceiver::_detachHardwareCapture() {
+    TIMSK1 &= ~(_BV(ICIE1) | _BV(TOIE1));
+    TCCR1B = 0;
+    IRHardwareCapture::s_owner = nullptr;
+}
+
+void IRReceiver::_pollHardwareCapture() {
+}
+
+#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__)
+// --- AVR: ICP1 Unavailable At This Clock ---
+// Timer1 ticks are not a whole fraction of a microsecond (e.g. a 14.7456 MHz crystal), so
+// IR_CAPTURE_HW_TIMER falls back to IR_CAPTURE_PIN_INTERRUPT.
+#warning "IRReceiver: ICP1 capture needs a whole-MHz F_CPU; IR_CAPTURE_HW_TIMER uses the pin interrupt"
+
+bool IRReceiver::_attachHardwareCapture() {
+    Debug(DEBUG_GENERAL, "IRReceiver: ICP1 capture is not available at this F_CPU, using the pin interrupt.\n");
+    m_captureMode = IR_CAPTURE_PIN_INTERRUPT;
+    return false;
+}
+
+void IRReceiver::_detachHardwareCapture() {
+}
+
+void IRReceiver::_pollHardwareCapture() {
+}
+
+#elif defined(ARDUINO_ARCH_STM32)
+// --- STM32: General Purpose Timer Input Capture ---
+// Uses whichever timer channel the pin is routed to, capturing both edges at 1 MHz. The
+// timer is limited to 16 bits on every instance and extended in the update interrupt.
+// Captures are taken from the channel interrupt; DMA is not needed at IR edge rates.
+static HardwareTimer* s_captureTimer = nullptr;
+static uint32_t s_captureChannel = 0;
+static volatile uint16_t s_captureOverflows = 0;
+
+static void onCaptureOverflow() {
+    s_captureOverflows++;
+}
+
+static void onCaptureEdge() {
+    uint16_t captured = s_captureTimer->getCaptureCompare(s_captureChannel);
+    uint16_t overflows = s_captureOverflows;
+    if (__HAL_TIM_GET_FLAG(s_captureTimer->getHandle(), TIM_FLAG_UPDATE) && captured < 0x8000) {
+        overflows++; // Overflow is pending and the capture happened after it
+    }
+    IRHardwareCapture::onToggle(((uint32_t)overflows << 16) | captured); // 1 tick = 1 us
+}
+
+bool IRReceiver::_attachHardwareCapture() {
+    if (!IRHardwareCapture::claim(this)) return false;
+    PinName pinName = digitalPinToPinName(m_irPin);
+    TIM_TypeDef* instance = (TIM_TypeDef*)pinmap_peripheral(pinName, PinMap_TIM);
+    if (instance == nullptr) {
+        Debug(DEBUG_GENERAL, "IRReceiver: Pin ", m_irPin, " is not connected to a timer channel.\n");
+        return false;
+    }
+    if (s_captureTimer != nullptr) {
+        delete s_captureTimer;
+    }
+    IRHardwareCapture::s_owner = this;
+    s_captureChannel = STM_PIN_CHANNEL(pinmap_function(pinName, PinMap_TIM));
+    s_captureOverflows = 0;
+    s_captureTimer = new HardwareTimer(instance);
+    s_captureTimer->setMode(s_captureChannel, TIMER_INPUT_CAPTURE_BOTHEDGE, m_irPin);
+    s_captureTimer->setPrescaleFactor(s_captureTimer->getTimerClkFreq() / 1000000); // 1 us ticks
+    s_captureTimer->setOverflow(0x10000);
+    s_captureTimer->attachInterrupt(s_captureChannel, onCaptureEdge);
+    s_captureTimer->attachInterrupt(onCaptureOverflow);
+    s_captureTimer->resume();
+    return true;
+}
+
+void IRReceiver::_detachHardwareCapture() {
+    if (s_captureTimer != nullptr) {
+        s_captureTimer->pause();
+        s_captureTimer->detachInterrupt(s_captureChannel);
+        s_captureTimer->detachInterrupt();
+    }
+    IRHardwareCapture::s_owner = nullptr;
+}
+
+void IRReceiver::_pollHardwareCapture() {
+}
+
+#elif defined(ESP32) && defined(ESP_IDF_VERSION_MAJOR) && (ESP_IDF_VERSION_MAJOR >= 5)
+// --- ESP32: RMT Receiver ---
+// The RMT peripheral records mark/space durations at 1 MHz on its own and reports a whole
+// reception once the line has been idle for RMT_IDLE_US, or once the symbol buffer is full.
+// Two buffers alternate: the done callback re-arms the receiver into the free one straight
+// away, so a held key that fills a buffer loses no more than the edges during the re-arm, and
+// isCode() converts finished buffers into ring entries later. Frames separated by more than
+// RMT_IDLE_US (NEC) arrive as separate receptions; their gap is rebuilt from the completion
+// timestamp. rmt_receive() is ISR safe, see CONFIG_RMT_RECV_FUNC_IN_IRAM.
+#include "driver/rmt_rx.h"
+#include "esp_timer.h"
+
+static const uint32_t RMT_IDLE_US = 30000;           // Below the 15-bit RMT duration limit
+static const size_t RMT_SYMBOLS = 2 * SOC_RMT_MEM_WORDS_PER_CHANNEL;
+static rmt_channel_handle_t s_rmtChannel = nullptr;
+static rmt_symbol_word_t s_rmtSymbols[2][RMT_SYMBOLS];
+static volatile size_t s_rmtReceivedSymbols[2] = {}; // Set by the done callback, cleared when consumed
+static volatile int64_t s_rmtDoneMicros[2] = {};
+static volatile bool s_rmtBufferFull[2] = {};        // Reception cut short by the buffer, not by idle
+static volatile uint8_t s_rmtReceiving = 0;          // Buffer the RMT is writing; written by the callback only
+static volatile uint8_t s_rmtNextRead = 0;           // Oldest unconsumed buffer; written by the reader only
+static volatile bool s_rmtArmed = false;
+
+static bool IRAM_ATTR startRmtReceive(uint8_t buffer) {
+    rmt_receive_config_t receiveConfig = {};
+    receiveConfig.signal_range_min_ns = 1000;                // Glitch filter
+    receiveConfig.signal_range_max_ns = RMT_IDLE_US * 1000;  // Idle time that ends a reception
+    s_rmtReceiving = buffer;
+    s_rmtArmed = rmt_receive(s_rmtChannel, s_rmtSymbols[buffer], sizeof(s_rmtSymbols[buffer]), &receiveConfig) == ESP_OK;
+    return s_rmtArmed;
+}
+
+// An idle completion ends with a zero duration (the end marker); a full buffer does not.
+static bool IRAM_ATTR rmtReceptionFull(const rmt_symbol_word_t symbols[], size_t count) {
+    return count >= RMT_SYMBOLS && symbols[count - 1].duration0 != 0 && symbols[count - 1].duration1 != 0;
+}
+
+static bool IRAM_ATTR onRmtReceiveDone(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t* edata, void* userCtx) {
+    uint8_t buffer = s_rmtReceiving;
+    uint8_t other = buffer ^ 1;
+    if (s_rmtReceivedSymbols[other] != 0) {
+        // The reader is still behind on the other buffer: receive into this one again and
+        // count the reception as dropped, rather than stop capturing
+        IRHardwareCapture::onDropped(2 * edata->num_symbols);
+        startRmtReceive(buffer);
+        return false;
+    }
+    s_rmtDoneMicros[buffer] = esp_timer_get_time();
+    s_rmtBufferFull[buffer] = rmtReceptionFull(s_rmtSymbols[buffer], edata->num_symbols);
+    s_rmtReceivedSymbols[buffer] = edata->num_symbols;
+    startRmtReceive(other);
+    IRHardwareCapture::onReception();
+    return false; // Any task switch was already requested by onReception()
+}
+
+bool IRReceiver::_attachHardwareCapture() {
+    if (!IRHardwareCapture::claim(this)) return false;
+    rmt_rx_channel_config_t channelConfig = {};
+    channelConfig.gpio_num = (gpio_num_t)m_irPin;
+    channelConfig.clk_src = RMT_CLK_SRC_DEFAULT;
+    channelConfig.resolution_hz = 1000000; // 1 tick = 1 us
+    channelConfig.mem_block_symbols = RMT_SYMBOLS;
+    if (rmt_new_rx_channel(&channelConfig, &s_rmtChannel) != ESP_OK) {
+        Debug(DEBUG_GENERAL, "IRReceiver: No free RMT channel for pin ", m_irPin, ".\n");
+        s_rmtChannel = nullptr;
+        return false;
+    }
+    rmt_rx_event_callbacks_t callbacks = {};
+    callbacks.on_recv_done = onRmtReceiveDone;
+    rmt_rx_register_event_callbacks(s_rmtChannel, &callbacks, nullptr);
+    rmt_enable(s_rmtChannel);
+
+    IRHardwareCapture::s_owner = this;
+    s_rmtReceivedSymbols[0] = 0;
+    s_rmtReceivedSymbols[1] = 0;
+    s_rmtNextRead = 0;
+    return startRmtReceive(0);
+}
+
+void IRReceiver::_detachHardwareCapture() {
+    if (s_rmtChannel != nullptr) {
+        rmt_disable(s_rmtChannel);
+        rmt_del_channel(s_rmtChannel);
+        s_rmtChannel = nullptr;
+    }
+    s_rmtArmed = false;
+    IRHardwareCapture::s_owner = nullptr;
+}
+
+// Replays completed receptions into the ring, oldest first, with timestamps rebuilt from
+// their durations. An idle completion ended RMT_IDLE_US after its last edge and the line is
+// idle again; a full buffer completed at its last edge, and the next buffer carries on.
+void IRReceiver::_pollHardwareCapture() {
+    if (s_rmtChannel == nullptr) {
+        return;
+    }
+    uint8_t buffer;
+    size_t symbolCount;
+    while ((symbolCount = s_rmtReceivedSymbols[buffer = s_rmtNextRead]) != 0) {
+        const rmt_symbol_word_t* symbols = s_rmtSymbols[buffer];
+        bool full = s_rmtBufferFull[buffer];
+        uint32_t totalMicros = 0;
+        for (size_t i = 0; i < symbolCount; ++i) {
+            totalMicros += symbols[i].duration0 + symbols[i].duration1;
+        }
+        int64_t lastEdgeMicros = s_rmtDoneMicros[buffer] - (full ? 0 : RMT_IDLE_US);
+        uint32_t edgeMicros = (uint32_t)(lastEdgeMicros - totalMicros);
+
+        for (size_t i = 0; i < symbolCount; ++i) {
+            const rmt_symbol_word_t& symbol = symbols[i];
+            _pushTransition(edgeMicros, symbol.level0 ? HIGH : LOW);
+            if (symbol.duration0 == 0) break; // End marker
+            edgeMicros += symbol.duration0;
+            _pushTransition(edgeMicros, symbol.level1 ? HIGH : LOW);
+            if (symbol.duration1 == 0) break;
+            edgeMicros += symbol.duration1;
+        }
+        if (!full) {
+            _pushTransition(edgeMicros, HIGH); // Line returned to idle
+        }
+        m_lastTransitionMillis = (unsigned long)(lastEdgeMicros / 1000); // Same clock as millis()
+
+        s_rmtReceivedSymbols[buffer] = 0; // Hands the buffer back to the callback
+        s_rmtNextRead = buffer ^ 1;
+    }
+    if (!s_rmtArmed) { // rmt_receive() failed in the callback
+        startRmtReceive(s_rmtReceiving);
+    }
+}
+
+#else
+// --- No Hardware Capture On This Platform ---
+bool IRReceiver::_attachHardwareCapture() {
+    if (!IRHardwareCapture::claim(this)) return false;
+    Debug(DEBUG_GENERAL, "IRReceiver: Hardware capture is not supported on this platform.\n");
+    return false;
+}
+
+void IRReceiver::_detachHardwareCapture() {
+}
+
+void IRReceiver::_pollHardwareCapture() {
+}
+#endif
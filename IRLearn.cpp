@@ -0,0 +1,133 @@
+#include "IRReceiver.h"
+
+#if IR_LIB_LEARNED_CODES > 0
+// --- Learned Codes ---
+// Remotes that no protocol descriptor covers (air conditioners, cheap LED controllers) can
+// still be told apart: each burst is reduced to a fingerprint of its timing shape, and
+// fingerprints taught with learnCode() are kept in a small open-addressed hash table shared
+// by all receivers. Matching a burst costs one hash over its first frame and a short probe.
+static_assert((IR_LIB_LEARNED_CODES & (IR_LIB_LEARNED_CODES - 1)) == 0, "IR_LIB_LEARNED_CODES must be a power of two");
+
+struct IrLearnedCode {
+    uint32_t fingerprint; // 0 marks a free slot
+    int command;
+};
+static IrLearnedCode s_learnedCodes[IR_LIB_LEARNED_CODES] = {};
+
+// Slot holding the fingerprint, or the free slot where it would go. IR_LIB_LEARNED_CODES when
+// the table is full. Codes are only ever cleared all at once, so probing stops at a free slot.
+static size_t learnedSlot(uint32_t fingerprint) {
+    const size_t mask = IR_LIB_LEARNED_CODES - 1;
+    size_t start = (fingerprint ^ (fingerprint >> 16)) & mask;
+    for (size_t probe = 0; probe < IR_LIB_LEARNED_CODES; probe++) {
+        size_t slot = (start + probe) & mask;
+        if (s_learnedCodes[slot].fingerprint == fingerprint || s_learnedCodes[slot].fingerprint == 0) {
+            return slot;
+        }
+    }
+    return IR_LIB_LEARNED_CODES;
+}
+
+// Stores a fingerprint, e.g. one saved from getLastFingerprint() earlier. Relearning a
+// fingerprint replaces its command. Returns false when the table is full.
+bool IRReceiver::addLearnedCode(uint32_t fingerprint, int command) {
+    if (fingerprint == 0) return false;
+    size_t slot = learnedSlot(fingerprint);
+    if (slot == IR_LIB_LEARNED_CODES) return false;
+    s_learnedCodes[slot].fingerprint = fingerprint;
+    s_learnedCodes[slot].command = command;
+    return true;
+}
+
+bool IRReceiver::findLearnedCode(uint32_t fingerprint, int& command) {
+    if (fingerprint == 0) return false;
+    size_t slot = learnedSlot(fingerprint);
+    if (slot == IR_LIB_LEARNED_CODES || s_learnedCodes[slot].fingerprint == 0) return false;
+    command = s_learnedCodes[slot].command;
+    return true;
+}
+
+void IRReceiver::clearLearnedCodes() {
+    for (size_t i = 0; i < IR_LIB_LEARNED_CODES; i++) {
+        s_learnedCodes[i].fingerprint = 0;
+    }
+}
+
+// The next burst that no protocol decodes is learned as command, and reported as a LEARNED
+// code with that command. -1 stops learning without storing anything.
+void IRReceiver::learnCode(int command) {
+    m_learnCommand = command;
+}
+
+bool IRReceiver::isLearning() const {
+    return m_learnCommand != -1;
+}
+
+uint32_t IRReceiver::getLastFingerprint() const {
+    return m_lastFingerprint;
+}
+
+// 0, 1 or 2 for a duration shorter than, about equal to or longer than the previous one of
+// the same kind. Bit encodings use ratios of 2 or more, so anything within a factor of 1.5 is
+// equal, which leaves room for the jitter of two durations at once.
+static uint8_t compareDuration(int duration, int previous) {
+    if ((int32_t)duration * 3 < (int32_t)previous * 2) return 0;
+    if ((int32_t)duration * 2 > (int32_t)previous * 3) return 2;
+    return 1;
+}
+
+// FNV-1a hash of the first frame of this pass with at least IR_LIB_FINGERPRINT_MIN_PAIRS
+// pairs: how each mark compares to the previous mark, and each space to the previous space.
+// Absolute timing drops out, so the same button hashes the same despite receiver jitter and
+// battery drift. The space ending the frame is left out. 0 when no frame qualifies.
+uint32_t IRReceiver::_fingerprintPass() const {
+    for (int s = 0; s < this->m_segmentCount; ++s) {
+        const BurstSegment& segment = this->m_segments[s];
+        if (segment.end - segment.start + 1 < IR_LIB_FINGERPRINT_MIN_PAIRS) {
+            continue;
+        }
+        uint32_t hash = 2166136261UL;
+        PulseSpacePair previous = _pair(segment.start);
+        for (int i = segment.start + 1; i <= segment.end; ++i) {
+            PulseSpacePair pair = _pair(i);
+            hash = (hash ^ compareDuration(pair.pulse, previous.pulse)) * 16777619UL;
+            if (i < segment.end) {
+                hash = (hash ^ compareDuration(pair.space, previous.space)) * 16777619UL;
+            }
+            previous = pair;
+        }
+        return hash != 0 ? hash : 1;
+    }
+    return 0;
+}
+
+// Called for a burst that no protocol decoded: learns or looks up its fingerprint, and queues
+// a LEARNED code when it is known.
+void IRReceiver::_finishLearnedBurst() {
+    uint32_t fingerprint = this->m_burstFingerprint;
+    if (fingerprint == 0) {
+        return;
+    }
+    this->m_lastFingerprint = fingerprint;
+    int command = -1;
+    if (this->m_learnCommand != -1) {
+        if (!addLearnedCode(fingerprint, this->m_learnCommand)) {
+            Debug(DEBUG_DECODE_SUMMARY, "Learned code table full, burst not learned.\n");
+            return;
+        }
+        command = this->m_learnCommand;
+        this->m_learnCommand = -1;
+        Debug(DEBUG_DECODE_SUMMARY, "Learned fingerprint ", fingerprint, " as command ", command, "\n");
+        Trace(IR_TRACE_LEARN, LEARNED, command, (int32_t)fingerprint);
+    } else if (!findLearnedCode(fingerprint, command)) {
+        Debug(DEBUG_DECODE_SUMMARY, "Fingerprint ", fingerprint, " not learned.\n");
+        return;
+    }
+    this->m_finalResultCode = DecodedIR();
+    this->m_finalResultCode.brand = LEARNED;
+    this->m_finalResultCode.command = command;
+    Trace(IR_TRACE_CODE, LEARNED, command, -1);
+    this->_queueBurstCode();
+}
+
+#endif // IR_LIB_LEARNED_CODES > 0
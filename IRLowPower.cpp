@@ -0,0 +1,140 @@
+#include "IRReceiver.h"
+
+#if IR_LIB_LOW_POWER
+// --- Wake-on-IR ---
+// Battery powered receivers sleep between presses: the receiver pin wakes the MCU, the burst
+// is captured and decoded by the usual isCode() calls, and readyToSleep() tells the sketch
+// when it can go back to sleep. Only IR_CAPTURE_PIN_INTERRUPT is supported, since the
+// peripherals behind IR_CAPTURE_HW_TIMER stop with their clocks.
+#if defined(ESP32)
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#elif defined(__AVR__)
+#include <avr/sleep.h>
+#elif defined(ARDUINO_ARCH_STM32)
+extern "C" void SystemClock_Config(void); // Per-variant clock setup, needed again after STOP
+#endif
+
+// True when nothing is in progress that needs the CPU: no burst in the ring, the line idle
+// and no release event pending. Codes already queued are the sketch's to collect first.
+bool IRReceiver::readyToSleep() const {
+    return m_isInterruptAttached && m_captureMode == IR_CAPTURE_PIN_INTERRUPT &&
+           _loadRawHead() == m_rawTail && m_lastPinState == HIGH && !m_holdActive;
+}
+
+// Sleeps until the receiver pin (or any other wake source the sketch set up) wakes the MCU.
+// Returns false without sleeping when readyToSleep() is false. The wake-up latency hides the
+// edge that woke the MCU, so it is added to the ring here, backdated by IR_LIB_WAKE_LATENCY_US.
+bool IRReceiver::sleepUntilIR() {
+    if (!readyToSleep()) {
+        return false;
+    }
+    if (m_awake) { // The previous wake-up ends here
+        uint32_t awakeMicros = micros() - m_wakeStartMicros;
+        m_stats.lastWakeMicros = awakeMicros;
+        m_wakeMicrosTotal += awakeMicros;
+        if (m_stats.wakeups < UINT32_MAX) m_stats.wakeups++;
+    }
+    Debug(DEBUG_GENERAL, "IRReceiver: Sleeping until the next IR edge.\n");
+    if (!_enterSleep()) {
+        m_awake = false;
+        return false;
+    }
+    m_wakeStartMicros = micros();
+    m_awake = true;
+
+    noInterrupts(); // _pushTransition() belongs to the ISR
+    if (digitalRead(m_irPin) == LOW) {
+        _pushTransition(m_wakeStartMicros - IR_LIB_WAKE_LATENCY_US, LOW);
+    }
+    interrupts();
+    return true;
+}
+
+#if defined(ESP32)
+// --- ESP32: Light Sleep with GPIO Wake-up ---
+// The pin's edge interrupt is swapped for a low level wake-up while asleep; a level interrupt
+// left enabled after waking would fire for the whole length of the mark.
+bool IRReceiver::_enterSleep() {
+    gpio_num_t pin = (gpio_num_t)m_irPin;
+    gpio_intr_disable(pin);
+    gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+    gpio_wakeup_disable(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable(pin);
+    return true;
+}
+
+#elif defined(__AVR__)
+// --- AVR: Power-down with Pin Change Wake-up ---
+// INT0/INT1 edge interrupts do not wake the MCU from power-down, pin change interrupts do.
+// Their vectors only need to exist, so this conflicts with libraries that define them
+// (SoftwareSerial, PinChangeInterrupt).
+#if defined(PCINT0_vect)
+EMPTY_INTERRUPT(PCINT0_vect);
+#endif
+#if defined(PCINT1_vect)
+EMPTY_INTERRUPT(PCINT1_vect);
+#endif
+#if defined(PCINT2_vect)
+EMPTY_INTERRUPT(PCINT2_vect);
+#endif
+#if defined(PCINT3_vect)
+EMPTY_INTERRUPT(PCINT3_vect);
+#endif
+
+bool IRReceiver::_enterSleep() {
+    volatile uint8_t* pcicr = digitalPinToPCICR(m_irPin);
+    volatile uint8_t* pcmsk = digitalPinToPCMSK(m_irPin);
+    if (pcicr == nullptr || pcmsk == nullptr) {
+        Debug(DEBUG_GENERAL, "IRReceiver: Pin ", m_irPin, " has no pin change interrupt, cannot sleep.\n");
+        return false;
+    }
+    uint8_t groupBit = _BV(digitalPinToPCICRbit(m_irPin));
+    uint8_t pinBit = _BV(digitalPinToPCMSKbit(m_irPin));
+    uint8_t oldMask = *pcmsk;
+    uint8_t oldControl = *pcicr;
+
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    cli();
+    *pcmsk |= pinBit;
+    PCIFR = groupBit;
+    *pcicr |= groupBit;
+    sleep_enable();
+    if (digitalRead(m_irPin) == HIGH) { // A mark that already started would never wake us
+#if defined(sleep_bod_disable)
+        sleep_bod_disable();
+#endif
+        sei(); // The instruction after sei() always runs first, so no wake-up is missed
+        sleep_cpu();
+    }
+    sleep_disable();
+    cli();
+    *pcmsk = oldMask;
+    *pcicr = oldControl;
+    sei();
+    return true;
+}
+
+#elif defined(ARDUINO_ARCH_STM32)
+// --- STM32: STOP Mode ---
+// The EXTI line attachInterrupt() set up for the pin also wakes the core from STOP. The
+// system clock falls back to the internal oscillator, so it is configured again.
+bool IRReceiver::_enterSleep() {
+    HAL_SuspendTick();
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+    SystemClock_Config();
+    HAL_ResumeTick();
+    return true;
+}
+
+#else
+bool IRReceiver::_enterSleep() {
+    Debug(DEBUG_GENERAL, "IRReceiver: Sleep is not supported on this platform.\n");
+    return false;
+}
+#endif
+
+#endif // IR_LIB_LOW_POWER
@@ -0,0 +1,45 @@
+
+#include "IRProtocolDefs.h"
+
+// --- Protocol Descriptors ---
+// Adding a protocol only needs a RemoteBrand entry and a row here, as long as it is a
+// pulse-distance or pulse-width code. Preambles are matched in table order.
+constexpr IrProtocol IR_PROTOCOLS[] = {
+#if IR_LIB_ENABLE_JVC
+    // JVC, format information is at https://www.sbprojects.net/knowledge/ir/jvc.php
+    { JVC, "JVC",
+      IR_TIMING(8400), IR_TIMING(4200),                        // Preamble
+      IR_REPEAT_NO_PREAMBLE, IR_TIMING_NONE, IR_TIMING_NONE,   // Repeats resend the 16 bits without preamble
+      { 12, 40 },                                              // Repeat gap, ms (22 ms nominal)
+      IR_PULSE_DISTANCE, IR_TIMING(526), IR_TIMING(526), IR_TIMING(1574),
+      16, 16,                        // Data bits, repeat data pairs
+      0, 8,                          // Address: 8 bits from bit 0
+      8, 8,                          // Command: 8 bits from bit 8
+      0 },
+#endif
+#if IR_LIB_ENABLE_SONY
+    // Sony SIRC-12 (also used by Sceptre)
+    { SONY, "SONY",
+      IR_TIMING(2400), IR_TIMING(600),
+      IR_REPEAT_FULL, IR_TIMING(2400), IR_TIMING(600),
+      { 12, 35 },                    // Frames every 45 ms
+      IR_PULSE_WIDTH, IR_TIMING(600), IR_TIMING(600), IR_TIMING(1200),
+      12, 12,
+      7, 5,                          // Address: 5 bits from bit 7
+      0, 7,                          // Command: 7 bits from bit 0
+      0 },
+#endif
+#if IR_LIB_ENABLE_NEC
+    // NEC, with 8-bit (inverted copy) or 16-bit extended address
+    { NEC, "NEC",
+      IR_TIMING(9000), IR_TIMING(4500),
+      IR_REPEAT_DITTO, IR_TIMING(8900), IR_TIMING(2200),       // Repeat frame: preamble plus stop bit only
+      { 25, 100 },                   // 40 ms after the data frame, 96 ms between ditto frames
+      IR_PULSE_DISTANCE, IR_TIMING(563), IR_TIMING(563), IR_TIMING(563 * 3),
+      32, 1,
+      0, 16,
+      16, 8,
+      IR_FIELD_ADDRESS_INVERTED | IR_FIELD_COMMAND_INVERTED },
+#endif
+};
+const size_t IR_PROTOCOLS_COUNT = sizeof(IR_PROTOCOLS) / sizeof(IrProtocol);
@@ -0,0 +1,123 @@
+#ifndef IR_PROTOCOL_DEFS_H
+#define IR_PROTOCOL_DEFS_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h>
+
+// --- Protocol Selection ---
+// Set any of these to 0 (here or with a -D build flag) to strip that protocol's descriptor,
+// button table and RemoteBrand entry from the build. Disabled protocols are never scored.
+#ifndef IR_LIB_ENABLE_JVC
+#define IR_LIB_ENABLE_JVC 1
+#endif
+#ifndef IR_LIB_ENABLE_SONY
+#define IR_LIB_ENABLE_SONY 1
+#endif
+#ifndef IR_LIB_ENABLE_NEC
+#define IR_LIB_ENABLE_NEC 1
+#endif
+
+#if !IR_LIB_ENABLE_JVC && !IR_LIB_ENABLE_SONY && !IR_LIB_ENABLE_NEC
+#error "IRReceiver: at least one IR_LIB_ENABLE_<protocol> must be set"
+#endif
+
+// Enum for remote brands
+#ifndef REMOTEBRAND_ENUM
+#define REMOTEBRAND_ENUM
+enum RemoteBrand {
+  UNKNOWN = 0, 
+#if IR_LIB_ENABLE_JVC
+  JVC,
+#endif
+#if IR_LIB_ENABLE_SONY
+  SONY,
+#endif
+#if IR_LIB_ENABLE_NEC
+  NEC,
+#endif
+  NUM_BRANDS,
+  LEARNED = NUM_BRANDS // Not a protocol: bursts recognised by a fingerprint taught with learnCode()
+};
+#endif
+
+// How a protocol carries a bit in each mark/space pair
+enum IrBitEncoding : uint8_t {
+    IR_PULSE_DISTANCE, // Fixed mark, bit value in the space length (JVC, NEC)
+    IR_PULSE_WIDTH     // Bit value in the mark length, fixed space (SONY)
+};
+
+// What a protocol sends while a button is held
+enum IrRepeatFrame : uint8_t {
+    IR_REPEAT_FULL,        // The whole frame again, preamble included (SONY)
+    IR_REPEAT_NO_PREAMBLE, // The data bits again without the preamble (JVC)
+    IR_REPEAT_DITTO        // A short frame with its own preamble and no data (NEC)
+};
+
+// Accepted range of one duration, precomputed so matching is two integer compares
+#ifndef IR_LIB_TIMING_TOLERANCE
+#define IR_LIB_TIMING_TOLERANCE 200 // +/- us around every nominal duration
+#endif
+struct IrTiming {
+    uint16_t min;
+    uint16_t max;
+    bool matches(int duration) const { return duration >= min && duration <= max; }
+    int nominal() const { return (min + max) / 2; }
+};
+#define IR_TIMING(us) { (uint16_t)((us) - IR_LIB_TIMING_TOLERANCE), (uint16_t)((us) + IR_LIB_TIMING_TOLERANCE) }
+#define IR_TIMING_NONE { 1, 0 } // Matches nothing
+
+// Field layout flags
+#define IR_FIELD_ADDRESS_INVERTED 0x01 // Address high byte is the complement of the low byte, else a 16-bit address
+#define IR_FIELD_COMMAND_INVERTED 0x02 // Command byte is followed by its complement (checksum)
+
+// The timings of a descriptor, by role
+enum IrTimingSlot : uint8_t {
+    IR_SLOT_PREAMBLE_PULSE,
+    IR_SLOT_PREAMBLE_SPACE,
+    IR_SLOT_REPEAT_PULSE,
+    IR_SLOT_REPEAT_SPACE,
+    IR_SLOT_FIXED,
+    IR_SLOT_ZERO,
+    IR_SLOT_ONE,
+    IR_SLOT_COUNT
+};
+
+// Timing is in microseconds. Bits are sent LSB first.
+struct IrProtocol {
+    RemoteBrand brand;
+    const char* name;
+    IrTiming preamblePulse;
+    IrTiming preambleSpace;
+    IrRepeatFrame repeatFrame;
+    IrTiming repeatPreamblePulse; // Only used by IR_REPEAT_FULL and IR_REPEAT_DITTO
+    IrTiming repeatPreambleSpace;
+    IrTiming repeatGapMs;         // Space between the frames of a held button, in milliseconds
+    IrBitEncoding encoding;
+    IrTiming fixedTiming;         // Mark (pulse distance) or space (pulse width) shared by every bit
+    IrTiming zeroTiming;          // Varying duration of a 0 bit
+    IrTiming oneTiming;           // Varying duration of a 1 bit
+    uint8_t dataBits;
+    uint8_t repeatDataPairs;      // Pairs after the preamble in a repeat frame
+    uint8_t addressShift;
+    uint8_t addressBits;
+    uint8_t commandShift;
+    uint8_t commandBits;
+    uint8_t fieldFlags;
+
+    const IrTiming& timing(IrTimingSlot slot) const {
+        switch (slot) {
+            case IR_SLOT_PREAMBLE_PULSE: return preamblePulse;
+            case IR_SLOT_PREAMBLE_SPACE: return preambleSpace;
+            case IR_SLOT_REPEAT_PULSE: return repeatPreamblePulse;
+            case IR_SLOT_REPEAT_SPACE: return repeatPreambleSpace;
+            case IR_SLOT_FIXED: return fixedTiming;
+            case IR_SLOT_ZERO: return zeroTiming;
+            default: return oneTiming;
+        }
+    }
+};
+
+extern const IrProtocol IR_PROTOCOLS[];
+extern const size_t IR_PROTOCOLS_COUNT;
+
+#endif // IR_PROTOCOL_DEFS_H
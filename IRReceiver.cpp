@@ -1,56 +1,344 @@
 #include "IRReceiver.h"
+#include <limits.h>
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif
+
+// Orders ring buffer accesses between the capture ISR and the consumer. Single-core AVR
+// only needs the volatile accesses themselves; 32-bit cores get a full barrier.
+#if defined(__AVR__)
+#define IR_LIB_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define IR_LIB_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+// Clock of the capture path. On ESP32 the core's micros()/millis() are only placed in IRAM
+// with CONFIG_ARDUINO_ISR_IRAM, so the ISR reads esp_timer directly, which they are built on
+// and which stays usable while the flash cache is off (OTA or LittleFS writes).
+#if defined(ESP32)
+static inline uint32_t IRAM_ATTR captureMicros() { return (uint32_t)esp_timer_get_time(); }
+static inline unsigned long IRAM_ATTR captureMillis() { return (unsigned long)(esp_timer_get_time() / 1000); }
+#else
+static inline uint32_t captureMicros() { return micros(); }
+static inline unsigned long captureMillis() { return millis(); }
+#endif
 
-// Initialize the static instance pointer
-IRReceiver* IRReceiver::s_instance = nullptr;
+// Per-slot instance pointers, one for each ISR trampoline
+IRReceiver* IRReceiver::s_instances[IR_LIB_MAX_RECEIVERS] = {};
 
 IRReceiver::IRReceiver() :
+    m_isrSlot(-1),
     m_irPin(-1),
-    m_rawTransitionIndex(0),
+#if IR_LIB_FAST_PIN_READ
+    m_pinInputRegister(nullptr),
+    m_pinBitMask(0),
+#endif
+    m_rawHead(0),
+    m_rawTail(0),
     m_lastTransitionMillis(0),
     m_lastPinState(HIGH),
-    m_rawBurstCopied(false),
+    m_heldMarkMicros(0),
+    m_heldMarkKnown(false),
+    m_minPulseMicros(IR_LIB_MIN_PULSE_US),
+#if IR_LIB_COMPACT_DURATIONS
+    m_lastEdgeMicros(0),
+#endif
+    m_edgesCaptured(0),
+    m_edgesDropped(0),
+    m_glitchesFiltered(0),
+    m_peakRingFill(0),
+#if IR_LIB_COMPACT_DURATIONS
+    m_pairRingStart(0),
+    m_pairEntryCount(0),
+#endif
     m_pulseSpacePairCount(0),
-    m_decodedSegmentCount(0),
-    m_codeResultIsReady(false),
-    m_isInterruptAttached(false) // Initialize as not attached
+    m_lastWinnerBrand(UNKNOWN),
+    m_codeQueueHead(0),
+    m_codeQueueCount(0),
+    m_codeQueueOverflows(0),
+    m_isInterruptAttached(false), // Initialize as not attached
+    m_captureMode(IR_CAPTURE_PIN_INTERRUPT),
+    m_streamingEnabled(false),
+    m_holdEventsEnabled(false),
+    m_holdActive(false),
+    m_earlyCommitFrames(IR_LIB_EARLY_COMMIT_FRAMES),
+    m_codeCallback(nullptr),
+#if IR_LIB_HAS_FREERTOS
+    m_decodeTask(nullptr),
+    m_decodeTaskQueue(nullptr),
+    m_decodeTaskStopping(false),
+#endif
+#if IR_LIB_END_TIMER
+    m_endTimer(nullptr),
+    m_endTimerArmed(false),
+    m_burstTimedOut(false),
+    m_lastTransitionMicros(0),
+    m_timedOutEdgeMicros(0),
+#endif
+    m_edgesCapturedBase(0),
+    m_edgesDroppedBase(0),
+    m_glitchesFilteredBase(0),
+    m_burstAnalysisMicros(0),
+    m_analysisMicrosTotal(0),
+    m_analysisBurstCount(0),
+    m_captureCallback(nullptr),
+    m_captureOutput(nullptr),
+    m_captureOpen(false),
+    m_captureIndex(0),
+    m_capturePrevValue(0),
+    m_captureLength(0)
+#if IR_LIB_LOW_POWER
+    , m_awake(false),
+    m_wakeStartMicros(0),
+    m_wakeMicrosTotal(0)
+#endif
+#if IR_LIB_LEARNED_CODES > 0
+    , m_learnCommand(-1),
+    m_burstFingerprint(0),
+    m_lastFingerprint(0)
+#endif
 {
-    for (int i = 0; i < NUM_BRANDS; ++i) {
-        m_brandScores[i] = 0;
+    _resetBurst(0);
+    _resetStream(0);
+}
+
+IRReceiver::~IRReceiver() {
+#if IR_LIB_HAS_FREERTOS
+    stopDecodeTask();
+#endif
+    if (m_isInterruptAttached) {
+        disable();
+    }
+    if (m_isrSlot != -1) {
+        s_instances[m_isrSlot] = nullptr;
     }
+#if IR_LIB_END_TIMER
+    if (m_endTimer != nullptr) {
+        esp_timer_stop(m_endTimer);
+        esp_timer_delete(m_endTimer);
+    }
+#endif
 }
 
 // --- ISR and Raw Capture ---
-void IRAM_ATTR IRReceiver::staticHandleIrInterrupt_priv() { // IRAM_ATTR on definition
-    if (s_instance) {
-        s_instance->handleIrInterrupt_priv();
+// attachInterrupt() only takes a plain function, so each receiver is routed through its own
+// trampoline that knows which instance it serves.
+template<int Slot> void IRAM_ATTR IRReceiver::staticHandleIrInterrupt_priv() { // IRAM_ATTR on definition
+    IRReceiver* instance = s_instances[Slot];
+    if (instance) {
+        instance->handleIrInterrupt_priv();
     }
 }
 
+static_assert(IR_LIB_MAX_RECEIVERS >= 1 && IR_LIB_MAX_RECEIVERS <= 8, "IR_LIB_MAX_RECEIVERS must be between 1 and 8");
+void (* const IRReceiver::s_isrTrampolines[])() = {
+    staticHandleIrInterrupt_priv<0>,
+#if IR_LIB_MAX_RECEIVERS > 1
+    staticHandleIrInterrupt_priv<1>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 2
+    staticHandleIrInterrupt_priv<2>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 3
+    staticHandleIrInterrupt_priv<3>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 4
+    staticHandleIrInterrupt_priv<4>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 5
+    staticHandleIrInterrupt_priv<5>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 6
+    staticHandleIrInterrupt_priv<6>,
+#endif
+#if IR_LIB_MAX_RECEIVERS > 7
+    staticHandleIrInterrupt_priv<7>,
+#endif
+};
+
+// One load and mask from the register cached by begin(), where digitalRead() would look the
+// pin up in tables (in flash on AVR and ESP) on every edge.
+inline int IRAM_ATTR IRReceiver::_readPin() const {
+#if IR_LIB_FAST_PIN_READ
+    const volatile ir_port_t* inputRegister = m_pinInputRegister;
+    if (inputRegister != nullptr) {
+        return (*inputRegister & m_pinBitMask) ? HIGH : LOW;
+    }
+#endif
+    return digitalRead(m_irPin);
+}
+
 void IRAM_ATTR IRReceiver::handleIrInterrupt_priv() { // IRAM_ATTR on definition
-    uint32_t currentTimeMicros = micros();
-    int currentState = digitalRead(m_irPin);
+    bool burstStarted = (m_rawHead == m_rawTail); // The ring is drained whenever a burst ends
+    _pushTransition(captureMicros(), _readPin());
+    _notifyDecodeTaskFromISR(burstStarted);
+}
 
-    if (currentState != m_lastPinState && m_rawTransitionIndex < IR_LIB_MAX_TRANSITIONS) {
-        uint32_t timeValue = currentTimeMicros & TIME_VALUE_MASK;
-        if (currentState == LOW && m_lastPinState == HIGH) {
-            timeValue |= DIRECTION_FLAG_H_TO_L;
-        }
-        m_rawTransitions[m_rawTransitionIndex] = timeValue;
-        m_rawTransitionIndex = m_rawTransitionIndex + 1;
-        m_lastPinState = currentState;
-        m_lastTransitionMillis = millis();
+// Feeds one recorded edge, timestamped like micros(), as if the pin ISR had seen it. Used
+// by the replay benchmark; the receiver must be begun with IR_CAPTURE_REPLAY, or enabled on
+// a pin with nothing attached, since live edges would interleave. The decode task is not
+// woken, so poll isCode().
+void IRReceiver::replayTransition(uint32_t timestampMicros, int pinLevel) {
+    _pushTransition(timestampMicros, pinLevel);
+}
+
+// Wakes the decode task at the start of a burst; it then sleeps until the idle timeout on its
+// own. Streaming decode needs every edge, so it is woken for each one instead.
+void IRAM_ATTR IRReceiver::_notifyDecodeTaskFromISR(bool burstStarted) {
+#if IR_LIB_HAS_FREERTOS
+    TaskHandle_t task = m_decodeTask;
+    if (task != nullptr && (burstStarted || m_streamingEnabled || m_holdEventsEnabled)) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+#else
+    (void)burstStarted;
+#endif
+}
+
+// Appends one edge to the ring. Shared by the pin ISR and the hardware capture backends.
+// With the glitch filter compiled in, a mark is only stored once it has ended: marks shorter
+// than m_minPulseMicros are dropped together with their start, merging them into the space.
+// Whole marks are stored or dropped, so the ring always alternates edge directions.
+void IRAM_ATTR IRReceiver::_pushTransition(uint32_t currentTimeMicros, int currentState) {
+    if (currentState == m_lastPinState) {
+        return;
+    }
+#if IR_LIB_MIN_PULSE_US > 0
+    m_lastPinState = currentState;
+    if (currentState == LOW) {
+        m_heldMarkMicros = currentTimeMicros;
+        m_heldMarkKnown = true;
+        _restartIdleTimeout(currentTimeMicros); // Not stored yet, but the burst goes on
+        return;
+    }
+    if (!m_heldMarkKnown) { // Began before enable(), on a clock the backend may not share
+        return;
+    }
+    if (currentTimeMicros - m_heldMarkMicros < m_minPulseMicros) {
+        m_glitchesFiltered = m_glitchesFiltered + 1;
+        return;
     }
+#endif
+    uint16_t head = m_rawHead;
+    uint16_t tail = m_rawTail;
+    uint16_t freeSlots = (tail > head) ? tail - head - 1 : tail + IR_LIB_MAX_TRANSITIONS - head - 1;
+#if IR_LIB_MIN_PULSE_US > 0
+    if (freeSlots < 2) { // Ring full: drop the mark
+        m_edgesDropped = m_edgesDropped + 2;
+        return;
+    }
+    _storeEdge(m_heldMarkMicros, true);
+    _storeEdge(currentTimeMicros, false);
+#else
+    if (freeSlots == 0) { // Ring full: drop the edge
+        m_edgesDropped = m_edgesDropped + 1;
+        return;
+    }
+    _storeEdge(currentTimeMicros, currentState == LOW);
+    m_lastPinState = currentState;
+#endif
+    _restartIdleTimeout(currentTimeMicros);
+}
+
+// The burst ends IR_LIB_IDLE_TIMEOUT_MS after the last edge seen here.
+void IRAM_ATTR IRReceiver::_restartIdleTimeout(uint32_t edgeMicros) {
+    m_lastTransitionMillis = captureMillis();
+#if IR_LIB_END_TIMER
+    m_lastTransitionMicros = edgeMicros;
+    if (!m_endTimerArmed && m_endTimer != nullptr) { // First edge since the timer last found the line quiet
+        m_endTimerArmed = true;
+        esp_timer_start_once(m_endTimer, IR_LIB_IDLE_TIMEOUT_MS * 1000ULL);
+    }
+#else
+    (void)edgeMicros;
+#endif
+}
+
+// Writes one edge at the head; the caller has checked that the ring has room for it.
+void IRAM_ATTR IRReceiver::_storeEdge(uint32_t edgeMicros, bool highToLow) {
+    uint16_t head = m_rawHead;
+    uint16_t nextHead = (head + 1 < IR_LIB_MAX_TRANSITIONS) ? head + 1 : 0;
+    uint16_t tail = m_rawTail;
+#if IR_LIB_COMPACT_DURATIONS
+    uint32_t elapsedMicros = edgeMicros - m_lastEdgeMicros;
+    ir_raw_t timeValue = (elapsedMicros < IR_DURATION_LONG_GAP) ? (ir_raw_t)elapsedMicros : IR_DURATION_LONG_GAP;
+    m_lastEdgeMicros = edgeMicros;
+#else
+    ir_raw_t timeValue = edgeMicros & TIME_VALUE_MASK;
+#endif
+    if (highToLow) {
+        timeValue |= DIRECTION_FLAG_H_TO_L;
+    }
+    m_rawTransitions[head] = timeValue;
+    IR_LIB_MEMORY_BARRIER(); // Entry must be visible before the consumer sees the new head
+    m_rawHead = nextHead;
+
+    uint16_t fill = (nextHead >= tail) ? nextHead - tail : nextHead + IR_LIB_MAX_TRANSITIONS - tail;
+    if (fill > m_peakRingFill) m_peakRingFill = fill;
+    m_edgesCaptured = m_edgesCaptured + 1;
 }
 
-bool IRReceiver::begin(int pin) {
-    s_instance = this; // Assign instance for ISR
+// --- Ring Index Access ---
+// The ring indices are 16 bits wide, which is not a single load/store on AVR.
+uint16_t IRReceiver::_loadRawHead() const {
+#if defined(__AVR__)
+    // Re-read until two consecutive loads agree, so a torn read caused by the ISR
+    // updating m_rawHead between the two byte loads is never used.
+    uint16_t head;
+    do {
+        head = m_rawHead;
+    } while (head != m_rawHead);
+    return head;
+#else
+    return m_rawHead;
+#endif
+}
+
+void IRReceiver::_storeRawTail(uint16_t tail) {
+    IR_LIB_MEMORY_BARRIER(); // Finish reading the entries before handing them back to the ISR
+#if defined(__AVR__)
+    // The ISR must never observe half of a 16-bit store; hold off interrupts for the
+    // two byte stores only (this is not a burst-length critical section).
+    uint8_t oldSREG = SREG;
+    cli();
+    m_rawTail = tail;
+    SREG = oldSREG;
+#else
+    m_rawTail = tail;
+#endif
+}
+
+bool IRReceiver::begin(int pin, IRCaptureMode mode) {
+    if (m_isrSlot == -1 && mode != IR_CAPTURE_REPLAY) { // Claim a trampoline slot once; later begin() calls reuse it
+        for (int i = 0; i < IR_LIB_MAX_RECEIVERS; ++i) {
+            if (s_instances[i] == nullptr) {
+                m_isrSlot = i;
+                s_instances[i] = this;
+                break;
+            }
+        }
+        if (m_isrSlot == -1) {
+            Debug(DEBUG_GENERAL, "IRReceiver: begin() failed, all ", IR_LIB_MAX_RECEIVERS, " receiver slots are in use.\n");
+            return false;
+        }
+    }
     
     if (m_isInterruptAttached && m_irPin != -1) { // If already begun and attached, detach first
         disable();
     }
     
     m_irPin = pin;
+    m_captureMode = mode;
     pinMode(m_irPin, INPUT_PULLUP);
+#if IR_LIB_FAST_PIN_READ
+    m_pinInputRegister = portInputRegister(digitalPinToPort(m_irPin)); // nullptr for pins without a port
+    m_pinBitMask = digitalPinToBitMask(m_irPin);
+#if defined(ESP8266)
+    if (m_irPin == 16) m_pinInputRegister = nullptr; // GPIO16 is in the RTC block, not GPI
+#endif
+#endif
     
     enable(); // Call enable to attach interrupt and set initial states
 
@@ -78,16 +366,48 @@ void IRReceiver::enable() {
 
     // Reset state variables for a clean capture session
     m_lastPinState = digitalRead(m_irPin); // Important to get current state before attach
+    m_heldMarkKnown = false;               // A mark in progress has no start on the capture clock, so it is dropped
     m_lastTransitionMillis = millis();
-    m_codeResultIsReady = false;
-    m_rawBurstCopied = false;
-    m_rawTransitionIndex = 0;
+#if IR_LIB_END_TIMER
+    if (m_endTimer == nullptr) {
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = _endTimerFired;
+        timerArgs.arg = this;
+        timerArgs.name = "IREndOfBurst";
+        if (esp_timer_create(&timerArgs, &m_endTimer) != ESP_OK) {
+            Debug(DEBUG_GENERAL, "IRReceiver: No end-of-burst timer, idle bursts are found by isCode() alone.\n");
+            m_endTimer = nullptr;
+        }
+    }
+    m_burstTimedOut = false;
+    m_lastTransitionMicros = captureMicros();
+#endif
+    _clearCodeQueue();
+    if (!m_isInterruptAttached) { // ISR not running, so both indices can be reset safely
+        m_rawHead = 0;
+        m_rawTail = 0;
+    }
+    _resetBurst(m_rawTail);
+    _resetStream(m_rawTail);
     // m_pulseSpacePairCount = 0; // Not strictly needed here, _processRawTransitionsToPairs resets it
-    // m_decodedSegmentCount = 0; // Not strictly needed, _analyzeAndDecodeBurst resets it
+
+    if (m_captureMode == IR_CAPTURE_HW_TIMER) {
+        m_isInterruptAttached = _attachHardwareCapture();
+        Debug(DEBUG_GENERAL, "IRReceiver: Hardware capture ", m_isInterruptAttached ? "ENABLED" : "not available", " on pin ", m_irPin, ".\n");
+        if (m_captureMode == IR_CAPTURE_HW_TIMER) {
+            return;
+        }
+        // The backend fell back to the pin interrupt
+    }
+    if (m_captureMode == IR_CAPTURE_REPLAY) { // Nothing to attach, replayTransition() feeds the ring
+        m_isInterruptAttached = true;
+        Debug(DEBUG_GENERAL, "IRReceiver: Replay capture ENABLED.\n");
+        return;
+    }
 
     // Attach the interrupt
     if (digitalPinToInterrupt(m_irPin) != NOT_AN_INTERRUPT) {
-        attachInterrupt(digitalPinToInterrupt(m_irPin), staticHandleIrInterrupt_priv, CHANGE);
+        attachInterrupt(digitalPinToInterrupt(m_irPin), s_isrTrampolines[m_isrSlot], CHANGE);
         m_isInterruptAttached = true;
         Debug(DEBUG_GENERAL, "IRReceiver: Interrupts ENABLED on pin ", m_irPin, ".\n");
     } else {
@@ -102,7 +422,14 @@ void IRReceiver::disable() {
         return;
     }
 
-    if (digitalPinToInterrupt(m_irPin) != NOT_AN_INTERRUPT) {
+    if (m_captureMode == IR_CAPTURE_HW_TIMER) {
+        _detachHardwareCapture();
+        m_isInterruptAttached = false;
+        Debug(DEBUG_GENERAL, "IRReceiver: Hardware capture DISABLED on pin ", m_irPin, ".\n");
+    } else if (m_captureMode == IR_CAPTURE_REPLAY) {
+        m_isInterruptAttached = false;
+        Debug(DEBUG_GENERAL, "IRReceiver: Replay capture DISABLED.\n");
+    } else if (digitalPinToInterrupt(m_irPin) != NOT_AN_INTERRUPT) {
         detachInterrupt(digitalPinToInterrupt(m_irPin));
         m_isInterruptAttached = false;
         Debug(DEBUG_GENERAL, "IRReceiver: Interrupts DISABLED on pin ", m_irPin, ".\n");
@@ -111,81 +438,411 @@ void IRReceiver::disable() {
          Debug(DEBUG_GENERAL, "IRReceiver: Error disabling interrupt. Pin ", m_irPin, " may not support interrupts (or state error).\n");
          m_isInterruptAttached = false; // Ensure flag is false
     }
+#if IR_LIB_END_TIMER
+    if (m_endTimer != nullptr) {
+        esp_timer_stop(m_endTimer);
+    }
+    m_endTimerArmed = false;
+#endif
     // When disabling, you might want to clear any partially captured data
     // or pending flags to prevent processing stale data when re-enabled.
-    m_rawTransitionIndex = 0;
-    m_rawBurstCopied = false;
-    m_codeResultIsReady = false;
+    m_rawTail = m_rawHead;
+    _resetBurst(m_rawTail);
+    _resetStream(m_rawTail);
+    _clearCodeQueue();
+    if (m_captureOpen) { // End the recording of the dropped burst
+        _captureByte(0);
+        _flushCapture();
+        m_captureOpen = false;
+    }
 }
 
-bool IRReceiver::isCode() {
-    if (!m_isInterruptAttached) { // If interrupts are not attached, no new codes can come
-        if(m_codeResultIsReady) return true; // but an old one might be pending from before disable
+// Streaming mode decodes frames edge by edge and publishes the code as soon
+// as the last data bit arrives. Bursts the stream decoders cannot resolve still go through
+// the batch analysis once the idle timeout expires.
+void IRReceiver::setStreamingDecode(bool enabled) {
+    m_streamingEnabled = enabled;
+}
+
+// Hold events report a press on the first frame, a repeat for every following frame of the
+// same code (NEC repeat frames carry the last code forward) and a release once the burst ends.
+// Frames are decoded as they arrive, as in streaming mode.
+void IRReceiver::setHoldEvents(bool enabled) {
+    m_holdEventsEnabled = enabled;
+    m_holdActive = false;
+}
+
+// Early commit publishes a burst's code as soon as its frames agree on it: after that many
+// identical frames in a row, or after a single frame whose checksum is valid (NEC). The rest of
+// the burst then only feeds the hold tracker. 0 (the IR_LIB_EARLY_COMMIT_FRAMES default) waits for the burst
+// to end, so that repeatCount counts all of its frames.
+void IRReceiver::setEarlyCommit(uint8_t frames) {
+    m_earlyCommitFrames = frames;
+}
+
+// Marks shorter than minPulseMicros are treated as noise spikes and never reach the ring
+// (IR_LIB_MIN_PULSE_US by default, 0 lets everything through). The shortest real marks are
+// around 500 us. Has no effect when IR_LIB_MIN_PULSE_US is defined as 0.
+void IRReceiver::setGlitchFilter(uint16_t minPulseMicros) {
+#if defined(__AVR__)
+    uint8_t oldSREG = SREG; // Read by the ISR, a byte at a time
+    cli();
+    m_minPulseMicros = minPulseMicros;
+    SREG = oldSREG;
+#else
+    m_minPulseMicros = minPulseMicros;
+#endif
+}
+
+// Codes are delivered through the onCode() callback instead of getCode(). Without an RTOS this
+// is called from loop() in place of isCode(); the decode task calls it by itself.
+void IRReceiver::onCode(IRCodeCallback callback) {
+    m_codeCallback = callback;
+}
+
+// Raw bursts are exported in the binary capture format, to a callback, to a Print such as
+// Serial, or both. Data is written from isCode() as frames are released, never from the ISR.
+void IRReceiver::onCaptureData(IRCaptureDataCallback callback) {
+    m_captureCallback = callback;
+}
+
+void IRReceiver::setCaptureOutput(Print* output) {
+    m_captureOutput = output;
+}
+
+// Analyzes any finished burst, then hands every queued code to the callback and, when the
+// decode task was started with one, the application queue. Returns the number of codes handed out.
+int IRReceiver::dispatchCodes() {
+    int dispatched = 0;
+    DecodedIR code;
+    while ((m_codeCallback != nullptr
+#if IR_LIB_HAS_FREERTOS
+            || m_decodeTaskQueue != nullptr
+#endif
+           ) && isCode() && getCodes(&code, 1) == 1) {
+#if IR_LIB_HAS_FREERTOS
+        if (m_decodeTaskQueue != nullptr && xQueueSend(m_decodeTaskQueue, &code, 0) != pdTRUE) {
+            if (m_codeQueueOverflows < UINT16_MAX) m_codeQueueOverflows++; // Application queue full
+        }
+#endif
+        if (m_codeCallback != nullptr) {
+            m_codeCallback(code);
+        }
+        dispatched++;
+    }
+    return dispatched;
+}
+
+#if IR_LIB_HAS_FREERTOS
+// Runs the decoder in its own task, woken by the capture interrupt, so the application neither
+// polls nor calls isCode()/getCode(). Codes go to the onCode() callback (called from the task)
+// and/or codeQueue, a queue created with xQueueCreate(n, sizeof(DecodedIR)).
+bool IRReceiver::startDecodeTask(QueueHandle_t codeQueue, UBaseType_t priority, int core) {
+    if (m_decodeTask != nullptr) {
+        Debug(DEBUG_GENERAL, "IRReceiver: Decode task already running.\n");
+        return false;
+    }
+    m_decodeTaskQueue = codeQueue;
+    m_decodeTaskStopping = false;
+    TaskHandle_t task = nullptr;
+#if defined(ESP32)
+    // Pinning to the other core keeps analysis off the application's core; the capture ISR
+    // stays on the core that called begin(), and the ring is safe across cores.
+    BaseType_t created = xTaskCreatePinnedToCore(_decodeTaskEntry, "IRDecode", IR_LIB_DECODE_TASK_STACK, this, priority, &task,
+                                                 core < 0 ? tskNO_AFFINITY : (BaseType_t)core);
+#else
+    (void)core; // Single core
+    BaseType_t created = xTaskCreate(_decodeTaskEntry, "IRDecode", IR_LIB_DECODE_TASK_STACK, this, priority, &task);
+#endif
+    if (created != pdPASS) {
+        Debug(DEBUG_GENERAL, "IRReceiver: Failed to create decode task.\n");
+        m_decodeTaskQueue = nullptr;
         return false;
     }
+    m_decodeTask = task;
+    xTaskNotifyGive(task); // Pick up anything captured before the task existed
+    return true;
+}
 
-    if (m_codeResultIsReady) {
-        return true; 
+void IRReceiver::stopDecodeTask() {
+    TaskHandle_t task = m_decodeTask;
+    if (task == nullptr) {
+        return;
+    }
+    m_decodeTaskStopping = true;
+    xTaskNotifyGive(task);
+    while (m_decodeTask != nullptr) { // The task clears the handle right before deleting itself
+        vTaskDelay(1);
     }
+    m_decodeTaskQueue = nullptr;
+}
 
-    if (m_rawTransitionIndex > 0 && (millis() - m_lastTransitionMillis > IR_LIB_IDLE_TIMEOUT_MS) && !m_rawBurstCopied) {
-        cli();
-        int capturedCount = m_rawTransitionIndex;
-        uint32_t localTransitions[IR_LIB_MAX_TRANSITIONS]; 
-        if (capturedCount > IR_LIB_MAX_TRANSITIONS) capturedCount = IR_LIB_MAX_TRANSITIONS;
+void IRReceiver::_decodeTaskEntry(void* receiver) {
+    static_cast<IRReceiver*>(receiver)->_decodeTaskLoop();
+}
 
-        for (int i = 0; i < capturedCount; i++) {
-            localTransitions[i] = m_rawTransitions[i];
+void IRReceiver::_decodeTaskLoop() {
+    while (!m_decodeTaskStopping) {
+        TickType_t wait = portMAX_DELAY; // Nothing captured: sleep until the ISR notifies
+        if (_loadRawHead() != m_rawTail) { // Burst in progress: wake again when it can be idle
+            unsigned long quietMillis = millis() - m_lastTransitionMillis;
+            unsigned long remainingMillis = quietMillis > IR_LIB_IDLE_TIMEOUT_MS ? 0 : IR_LIB_IDLE_TIMEOUT_MS - quietMillis;
+            wait = pdMS_TO_TICKS(remainingMillis) + 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!m_decodeTaskStopping) {
+            dispatchCodes();
         }
-        m_rawTransitionIndex = 0; 
-        sei();
+    }
+    m_decodeTask = nullptr;
+    vTaskDelete(nullptr);
+}
+#endif
 
-        m_rawBurstCopied = true; 
-        _processRawTransitionsToPairs(localTransitions, capturedCount);
+#if IR_LIB_END_TIMER
+// --- End-of-Burst Timer ---
+// The first edge of a burst arms a one-shot esp_timer for IR_LIB_IDLE_TIMEOUT_MS. When it fires
+// (in the esp_timer task) and edges kept arriving, it re-arms for the rest of the timeout from
+// the last edge. Re-arming from the callback instead of restarting the timer on every edge
+// keeps the ISR down to a store and a flag test. Once the line has been quiet long enough, the burst is marked
+// ended and the decode task is woken, so it is decoded on time instead of at the next poll.
+void IRReceiver::_endTimerFired(void* receiver) {
+    IRReceiver* self = static_cast<IRReceiver*>(receiver);
+    const uint32_t timeoutMicros = IR_LIB_IDLE_TIMEOUT_MS * 1000UL;
+    uint32_t lastEdgeMicros = self->m_lastTransitionMicros;
+    uint32_t quietMicros = captureMicros() - lastEdgeMicros;
+    if (quietMicros < timeoutMicros) {
+        esp_timer_start_once(self->m_endTimer, timeoutMicros - quietMicros);
+        return;
+    }
+    self->m_timedOutEdgeMicros = lastEdgeMicros;
+    self->m_burstTimedOut = true;
+    self->m_endTimerArmed = false;
+    if (self->m_lastTransitionMicros != lastEdgeMicros && !self->m_endTimerArmed) {
+        self->m_endTimerArmed = true; // An edge slipped in before the ISR could see the timer idle
+        esp_timer_start_once(self->m_endTimer, timeoutMicros);
+    }
+#if IR_LIB_HAS_FREERTOS
+    TaskHandle_t task = self->m_decodeTask;
+    if (task != nullptr) {
+        xTaskNotifyGive(task);
+    }
+#endif
+}
+#endif
 
-        if (m_pulseSpacePairCount > 0) {
-            Debug(DEBUG_BURST, "\n--- IR Signal Burst Detected (Library Internal) ---\n"); 
-            Debug(DEBUG_BURST, "Number of pulse/space pairs extracted: ", m_pulseSpacePairCount, "\n");
+// True once the burst in the ring has ended: the end-of-burst timer found the line quiet after
+// its last edge, or isCode() sees that IR_LIB_IDLE_TIMEOUT_MS have passed since it.
+bool IRReceiver::_burstIdle() const {
+#if IR_LIB_END_TIMER
+    if (m_burstTimedOut && m_timedOutEdgeMicros == m_lastTransitionMicros) {
+        return true;
+    }
+#endif
+    return millis() - m_lastTransitionMillis > IR_LIB_IDLE_TIMEOUT_MS;
+}
 
-#ifdef DEBUG_BURST 
-            if((DEBUG & DEBUG_BURST) == DEBUG_BURST) { 
-                Debug(DEBUG_BURST, "Pulse/Space Pairs (us):\n");
-                for (int i = 0; i < m_pulseSpacePairCount; ++i) {
-                    Debug(DEBUG_BURST, "  Pair ", i, ": Pulse=", m_pulseSpacePairs[i].pulse, ", Space=", (m_pulseSpacePairs[i].space == -1 ? "MISSING" : String(m_pulseSpacePairs[i].space).c_str()), "\n");
-                }
+// Analysis keeps running while codes are queued, so a slow loop() only loses codes once
+// more than IR_LIB_EVENT_QUEUE_DEPTH of them are waiting.
+bool IRReceiver::isCode() {
+    if (!m_isInterruptAttached) { // If interrupts are not attached, no new codes can come
+        return m_codeQueueCount > 0; // but old ones might still be queued
+    }
+
+    // Snapshot the head before the idle check: any edge arriving after this point
+    // belongs to the next burst and stays in the ring for the next call.
+    if (m_captureMode == IR_CAPTURE_HW_TIMER) {
+        _pollHardwareCapture(); // Backends that complete whole receptions hand them over here
+    }
+
+    uint16_t head = _loadRawHead();
+    uint16_t tail = m_rawTail;
+
+    if (m_holdEventsEnabled || (m_streamingEnabled && !m_streamEmitted)) {
+        _streamRawTransitions(head);
+    }
+
+    if (head != tail && _burstIdle()) {
+        bool alreadyStreamed = m_streamEmitted;
+        _resetStream(head);
+        if (m_holdActive) {
+            _holdRelease();
+        }
+        _recordCapture(head, true);
+        if (alreadyStreamed) { // The stream decoders or an early commit already published this burst
+            _storeRawTail(head);
+            _countBurst(m_burstAnalysisMicros > 0);
+            _resetBurst(head);
+            Debug(DEBUG_BURST, "Burst already published, skipping batch analysis.\n");
+            Trace(IR_TRACE_BURST_STREAMED, UNKNOWN, 0, 0);
+            return m_codeQueueCount > 0;
+        }
+
+        Debug(DEBUG_BURST, "\n--- IR Signal Burst Ended (Library Internal) ---\n"); 
+        Trace(IR_TRACE_BURST_END, UNKNOWN, (head + IR_LIB_MAX_TRANSITIONS - tail) % IR_LIB_MAX_TRANSITIONS, 0);
+        _timedAnalyzeFrames(tail, head); // Whatever followed the last frame gap
+        _storeRawTail(head);             // Release the slots back to the ISR
+        uint32_t finishStart = micros();
+        _finishBurst();
+        m_burstAnalysisMicros += micros() - finishStart;
+        _countBurst(true);
+        _resetBurst(head);
+    } else if (head != tail) {
+        // Frames that are already closed by a gap are analyzed now and their slots handed back,
+        // so a held button never fills the ring and each pass stays one frame long.
+        uint16_t boundary;
+        if (_findFrameBoundary(head, boundary)) {
+            uint16_t frameEnd = (boundary + 1 < IR_LIB_MAX_TRANSITIONS) ? boundary + 1 : 0;
+            if (!m_streamEmitted) {
+                _timedAnalyzeFrames(tail, frameEnd);
+                _commitBurst();
             }
-#endif
-            _analyzeAndDecodeBurst(); 
-        } else {
-            Debug(DEBUG_BURST, "No pulse/space pairs extracted from burst.\n");
-            m_rawBurstCopied = false; 
+            _recordCapture(frameEnd, false);
+            _storeRawTail(boundary); // The edge ending the gap is the base of the next frame
         }
-        return m_codeResultIsReady;
-    } else if (m_rawTransitionIndex == 0 && m_rawBurstCopied) {
-        m_rawBurstCopied = false;
     }
-    return false;
+    return m_codeQueueCount > 0;
 }
 
 DecodedIR IRReceiver::getCode() {
-    if (m_codeResultIsReady) {
-        m_codeResultIsReady = false;
-        // m_rawBurstCopied is reset when a new burst starts processing in isCode()
-        // or if isCode() determines no pairs were extracted.
-        return m_finalResultCode;
+    DecodedIR code;
+    getCodes(&code, 1);
+    return code;
+}
+
+// Moves up to maxCodes queued codes, oldest first, into codes[]. Returns how many were copied.
+int IRReceiver::getCodes(DecodedIR codes[], int maxCodes) {
+    int copied = 0;
+    while (copied < maxCodes && m_codeQueueCount > 0) {
+        codes[copied++] = m_codeQueue[m_codeQueueHead];
+        m_codeQueueHead = (m_codeQueueHead + 1) % IR_LIB_EVENT_QUEUE_DEPTH;
+        m_codeQueueCount--;
     }
-    return DecodedIR(); 
+    return copied;
 }
 
-// _processRawTransitionsToPairs - REMAINS THE SAME
-void IRReceiver::_processRawTransitionsToPairs(const uint32_t localTransitions[], int capturedCount) {
+// Codes discarded because the queue was full. Saturates instead of wrapping.
+uint16_t IRReceiver::getOverflowCount() const {
+    return m_codeQueueOverflows;
+}
+
+// --- Statistics ---
+// Decode side counters are copied as they are; the ISR counters relative to the last reset.
+IRStats IRReceiver::getStats() const {
+    IRStats stats = m_stats;
+#if defined(__AVR__)
+    uint8_t oldSREG = SREG; // The 32-bit ISR counters take several loads each
+    cli();
+#endif
+    uint32_t captured = m_edgesCaptured;
+    uint32_t dropped = m_edgesDropped;
+    uint32_t glitches = m_glitchesFiltered;
+    stats.peakRingFill = m_peakRingFill;
+#if defined(__AVR__)
+    SREG = oldSREG;
+#endif
+    stats.edgesCaptured = captured - m_edgesCapturedBase;
+    stats.edgesDropped = dropped - m_edgesDroppedBase;
+    stats.glitchesFiltered = glitches - m_glitchesFilteredBase;
+    stats.averageAnalysisMicros = m_analysisBurstCount ? m_analysisMicrosTotal / m_analysisBurstCount : 0;
+#if IR_LIB_LOW_POWER
+    stats.averageWakeMicros = m_stats.wakeups ? m_wakeMicrosTotal / m_stats.wakeups : 0;
+#endif
+    return stats;
+}
+
+void IRReceiver::resetStats() {
+    m_stats = IRStats();
+    m_analysisMicrosTotal = 0;
+    m_analysisBurstCount = 0;
+#if IR_LIB_LOW_POWER
+    m_wakeMicrosTotal = 0;
+#endif
+#if defined(__AVR__)
+    uint8_t oldSREG = SREG;
+    cli();
+#endif
+    m_edgesCapturedBase = m_edgesCaptured;
+    m_edgesDroppedBase = m_edgesDropped;
+    m_glitchesFilteredBase = m_glitchesFiltered;
+    m_peakRingFill = 0;
+#if defined(__AVR__)
+    SREG = oldSREG;
+#endif
+}
+
+// _analyzeFrames() with its run time added to the current burst.
+void IRReceiver::_timedAnalyzeFrames(uint16_t startIndex, uint16_t endIndex) {
+    uint32_t start = micros();
+    _analyzeFrames(startIndex, endIndex);
+    m_burstAnalysisMicros += micros() - start;
+}
+
+// Called once per ended burst, with m_finalResultCode holding its code if it had one.
+// Bursts published by the stream decoders are not in the analysis time figures.
+void IRReceiver::_countBurst(bool analyzed) {
+    if (m_stats.burstsAnalyzed < UINT32_MAX) m_stats.burstsAnalyzed++;
+    if (m_finalResultCode.brand == LEARNED && m_finalResultCode.command != -1) {
+        if (m_stats.learnedMatches < UINT32_MAX) m_stats.learnedMatches++;
+    } else if (m_finalResultCode.brand != UNKNOWN && m_finalResultCode.command != -1) {
+        m_lastWinnerBrand = m_finalResultCode.brand;
+        uint16_t& wins = m_stats.protocolWins[m_finalResultCode.brand];
+        if (wins < UINT16_MAX) wins++;
+    } else if (m_stats.burstsUndecoded < UINT32_MAX) {
+        m_stats.burstsUndecoded++;
+    }
+    if (analyzed) {
+        if (m_burstAnalysisMicros > m_stats.maxAnalysisMicros) m_stats.maxAnalysisMicros = m_burstAnalysisMicros;
+        m_analysisMicrosTotal += m_burstAnalysisMicros;
+        m_analysisBurstCount++;
+    }
+}
+
+void IRReceiver::_queueCode(const DecodedIR& code) {
+    if (m_codeQueueCount == IR_LIB_EVENT_QUEUE_DEPTH) { // Full: drop the oldest so the newest press is kept
+        m_codeQueueHead = (m_codeQueueHead + 1) % IR_LIB_EVENT_QUEUE_DEPTH;
+        m_codeQueueCount--;
+        if (m_codeQueueOverflows < UINT16_MAX) m_codeQueueOverflows++;
+        Debug(DEBUG_GENERAL, "IRReceiver: Code queue full, oldest code dropped.\n");
+        Trace(IR_TRACE_QUEUE_OVERFLOW, UNKNOWN, m_codeQueueOverflows, 0);
+    }
+    m_codeQueue[(m_codeQueueHead + m_codeQueueCount) % IR_LIB_EVENT_QUEUE_DEPTH] = code;
+    m_codeQueueCount++;
+}
+
+void IRReceiver::_clearCodeQueue() {
+    m_codeQueueHead = 0;
+    m_codeQueueCount = 0;
+}
+
+// Reads the burst in place from the ring, from startIndex up to (not including) endIndex.
+void IRReceiver::_processRawTransitionsToPairs(uint16_t startIndex, uint16_t endIndex) {
     m_pulseSpacePairCount = 0; 
 
+    int capturedCount = (endIndex >= startIndex) ? endIndex - startIndex : IR_LIB_MAX_TRANSITIONS - startIndex + endIndex;
     if (capturedCount < 2) {
         Debug(DEBUG_RAW_TIMING, "Not enough transitions (", capturedCount, ") to process burst.\n");
         return;
     }
-    uint32_t previousTimeVal = localTransitions[0] & TIME_VALUE_MASK;
+#if IR_LIB_COMPACT_DURATIONS
+    // The first entry holds the idle time before the burst, marks and spaces alternate after it
+    m_pairRingStart = startIndex;
+    m_pairEntryCount = capturedCount;
+    m_pulseSpacePairCount = capturedCount / 2;
+#ifdef DEBUG_RAW_TIMING
+    if((DEBUG & DEBUG_RAW_TIMING) == DEBUG_RAW_TIMING) { 
+        Debug(DEBUG_RAW_TIMING, "\nRaw Durations:\n");
+        uint16_t ringIndex = startIndex;
+        for (int i = 1; i < capturedCount; i++) {
+            ringIndex = (ringIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? ringIndex + 1 : 0;
+            ir_raw_t value = m_rawTransitions[ringIndex];
+            Debug(DEBUG_RAW_TIMING, i, ": ", (value & DIRECTION_FLAG_H_TO_L) ? "H->L" : "L->H", " | Delta: ", value & TIME_VALUE_MASK, " us\n");
+        }
+    }
+#endif
+#else
+    ir_raw_t previousValue = m_rawTransitions[startIndex];
+    uint16_t ringIndex = startIndex;
 
 #ifdef DEBUG_RAW_TIMING
     if((DEBUG & DEBUG_RAW_TIMING) == DEBUG_RAW_TIMING) { 
@@ -197,10 +854,12 @@ void IRReceiver::_processRawTransitionsToPairs(const uint32_t localTransitions[]
     for (int i = 1; i < capturedCount; i++) { 
         if (m_pulseSpacePairCount >= (IR_LIB_MAX_TRANSITIONS / 2)) {
              Debug(DEBUG_BURST, "Warning: Exceeded pulseSpacePairs buffer.\n"); 
+             Trace(IR_TRACE_PAIRS_FULL, UNKNOWN, capturedCount - i, 0);
              break;
         }
 
-        uint32_t value = localTransitions[i];
+        ringIndex = (ringIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? ringIndex + 1 : 0;
+        ir_raw_t value = m_rawTransitions[ringIndex];
         uint32_t currentTimeVal = value & TIME_VALUE_MASK;
         bool isHighToLow = (value & DIRECTION_FLAG_H_TO_L) != 0;
 
@@ -209,12 +868,7 @@ void IRReceiver::_processRawTransitionsToPairs(const uint32_t localTransitions[]
             Debug(DEBUG_RAW_TIMING, i, ": ", currentTimeVal, " us | ", (isHighToLow ? "H->L" : "L->H"));
         }
 #endif
-        uint32_t deltaTime;
-        if (currentTimeVal >= previousTimeVal) {
-            deltaTime = currentTimeVal - previousTimeVal;
-        } else {
-            deltaTime = (TIME_VALUE_MASK - previousTimeVal) + currentTimeVal + 1;
-        }
+        uint32_t deltaTime = entryDuration(previousValue, value);
 #ifdef DEBUG_RAW_TIMING
         if((DEBUG & DEBUG_RAW_TIMING) == DEBUG_RAW_TIMING) { 
             Debug(DEBUG_RAW_TIMING, " | Delta: ", deltaTime, " us");
@@ -237,7 +891,7 @@ void IRReceiver::_processRawTransitionsToPairs(const uint32_t localTransitions[]
                 currentPulse = -1;
             }
         }
-        previousTimeVal = currentTimeVal;
+        previousValue = value;
     }
 
 #ifdef DEBUG_RAW_TIMING
@@ -251,600 +905,985 @@ void IRReceiver::_processRawTransitionsToPairs(const uint32_t localTransitions[]
         m_pulseSpacePairCount++;
     } else if (currentPulse != -1) { 
         Debug(DEBUG_BURST, "Warning: Exceeded pulseSpacePairs buffer for final pulse.\n");
+        Trace(IR_TRACE_PAIRS_FULL, UNKNOWN, 1, 0);
     }
+#endif
+#if IR_LIB_SYMBOL_STREAM
+    _quantizePairs();
+#endif
 }
 
+// Pair i of the burst under analysis. Compact builds read it from the ring, which stays owned
+// by the consumer until the analysis is done.
+PulseSpacePair IRReceiver::_pair(int index) const {
+#if IR_LIB_COMPACT_DURATIONS
+    PulseSpacePair pair;
+    int offset = 1 + 2 * index;
+    uint16_t ringIndex = m_pairRingStart + offset;
+    if (ringIndex >= IR_LIB_MAX_TRANSITIONS) ringIndex -= IR_LIB_MAX_TRANSITIONS;
+    pair.pulse = m_rawTransitions[ringIndex] & TIME_VALUE_MASK;
+    if (offset + 1 < m_pairEntryCount) {
+        ringIndex = (ringIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? ringIndex + 1 : 0;
+        pair.space = m_rawTransitions[ringIndex] & TIME_VALUE_MASK;
+    } else {
+        pair.space = -1; // Final mark, its space belongs to the next burst
+    }
+    return pair;
+#else
+    return m_pulseSpacePairs[index];
+#endif
+}
 
-void IRReceiver::_analyzeAndDecodeBurst() {
-    Debug(DEBUG_BURST, "\n--- Lib Internal: analyzeBurst ---\n"); 
+// Duration of the level that ended at currentValue's edge.
+uint32_t IRReceiver::entryDuration(ir_raw_t previousValue, ir_raw_t currentValue) {
+#if IR_LIB_COMPACT_DURATIONS
+    (void)previousValue;
+    return currentValue & TIME_VALUE_MASK;
+#else
+    return transitionDelta(previousValue & TIME_VALUE_MASK, currentValue & TIME_VALUE_MASK);
+#endif
+}
 
-    for(int i = 0; i < NUM_BRANDS; ++i) { 
-        this->m_brandScores[i] = 0;
+uint32_t IRReceiver::transitionDelta(uint32_t previousTimeVal, uint32_t currentTimeVal) {
+    if (currentTimeVal >= previousTimeVal) {
+        return currentTimeVal - previousTimeVal;
     }
-    this->m_decodedSegmentCount = 0; 
-    this->m_finalResultCode = DecodedIR(); 
-    this->m_codeResultIsReady = false;   
+    return (TIME_VALUE_MASK - previousTimeVal) + currentTimeVal + 1; // micros() wrapped
+}
 
-    if (this->m_pulseSpacePairCount == 0) {
-        Debug(DEBUG_BURST, "No pulse/space pairs provided for analysis.\n");
-        return;
+// --- Duration Symbols ---
+// Every pulse and space of a pass is quantized once into a byte symbol, so preamble matching
+// and bit extraction look up one table entry per duration instead of comparing it against each
+// window. The protocol windows overlap (NEC, JVC and SONY bits are all about 550 us), so a
+// symbol is not a single name like SHORT or NEC_HDR: it is the span between two adjacent window
+// edges, and the table records which timings of each protocol accept that whole span.
+#if IR_LIB_SYMBOL_STREAM
+#define IR_SYMBOL_MAX_BOUNDS (2 * IR_SLOT_COUNT * NUM_BRANDS)
+#define IR_SYMBOL_BLOCK_SHIFT 6
+#define IR_SYMBOL_BLOCKS 160 // Up to 10240 us, past every built-in window; longer durations step from the last block
+
+struct IrSymbolTable {
+    uint16_t bounds[IR_SYMBOL_MAX_BOUNDS]; // Ascending; symbol s covers [bounds[s - 1], bounds[s])
+    uint8_t boundCount;
+    uint8_t timings[IR_SYMBOL_MAX_BOUNDS + 1][NUM_BRANDS]; // 1 << IrTimingSlot per matching timing
+    uint8_t blockStart[IR_SYMBOL_BLOCKS];
+
+    IrSymbolTable() : boundCount(0) {
+        for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+            for (uint8_t slot = 0; slot < IR_SLOT_COUNT; ++slot) {
+                const IrTiming& timing = IR_PROTOCOLS[p].timing((IrTimingSlot)slot);
+                if (timing.min > timing.max) continue; // IR_TIMING_NONE
+                addBound(timing.min);
+                addBound(timing.max + 1);
+            }
+        }
+        for (uint8_t symbol = 0; symbol <= boundCount; ++symbol) {
+            int duration = symbol == 0 ? -1 : bounds[symbol - 1]; // Symbol 0 also holds missing spaces
+            for (int brand = 0; brand < NUM_BRANDS; ++brand) timings[symbol][brand] = 0;
+            for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+                for (uint8_t slot = 0; slot < IR_SLOT_COUNT; ++slot) {
+                    if (IR_PROTOCOLS[p].timing((IrTimingSlot)slot).matches(duration)) {
+                        timings[symbol][IR_PROTOCOLS[p].brand] |= (1 << slot);
+                    }
+                }
+            }
+        }
+        uint8_t symbol = 0;
+        for (int block = 0; block < IR_SYMBOL_BLOCKS; ++block) {
+            while (symbol < boundCount && (block << IR_SYMBOL_BLOCK_SHIFT) >= bounds[symbol]) symbol++;
+            blockStart[block] = symbol;
+        }
     }
 
-    Debug(DEBUG_BRAND, "\n--- Lib Internal: Scoring Brands ---\n");
-    this->m_brandScores[SONY] = this->scoreSonySIRC12(this->m_pulseSpacePairs, this->m_pulseSpacePairCount);
-    this->m_brandScores[JVC] = this->scoreJVC(this->m_pulseSpacePairs, this->m_pulseSpacePairCount);
-    this->m_brandScores[NEC] = this->scoreNEC(this->m_pulseSpacePairs, this->m_pulseSpacePairCount);
+    void addBound(uint16_t bound) {
+        uint8_t i = boundCount;
+        while (i > 0 && bounds[i - 1] > bound) i--;
+        if (i > 0 && bounds[i - 1] == bound) return;
+        for (uint8_t j = boundCount; j > i; --j) bounds[j] = bounds[j - 1];
+        bounds[i] = bound;
+        boundCount++;
+    }
 
-    Debug(DEBUG_BRAND, "\n--- Lib Internal: Remote Brand Scores (Final) ---\n");
-    Debug(DEBUG_BRAND, "JVC Score: ", this->m_brandScores[JVC], "\n", "SONY Score: ", this->m_brandScores[SONY], "\n", "NEC Score: ", this->m_brandScores[NEC], "\n");
-    Debug(DEBUG_BRAND, "-----------------------------------\n");
+    // Number of bounds at or below duration. The coarse table gives the first symbol of the
+    // duration's 64 us block, and blocks hold few bounds, so this is a step or two.
+    uint8_t quantize(int duration) const {
+        if (duration < 0) return 0;
+        int block = duration >> IR_SYMBOL_BLOCK_SHIFT;
+        uint8_t symbol = blockStart[block < IR_SYMBOL_BLOCKS ? block : IR_SYMBOL_BLOCKS - 1];
+        while (symbol < boundCount && duration >= bounds[symbol]) symbol++;
+        return symbol;
+    }
+};
+// IR_PROTOCOLS is constant initialized, so the table can be built during static initialization.
+static const IrSymbolTable s_symbols;
+
+void IRReceiver::_quantizePairs() {
+    for (int i = 0; i < m_pulseSpacePairCount; ++i) {
+        m_pairSymbols[i][0] = s_symbols.quantize(m_pulseSpacePairs[i].pulse);
+        m_pairSymbols[i][1] = s_symbols.quantize(m_pulseSpacePairs[i].space);
+    }
+}
+#endif
 
-    RemoteBrand winningBrand = UNKNOWN;
-    int maxScore = 0;
-    for(int i = 1; i < NUM_BRANDS; ++i) {
-        if (this->m_brandScores[i] > maxScore) {
-            maxScore = this->m_brandScores[i];
-            winningBrand = (RemoteBrand)i;
+// Whether the pulse (or space) of pair index fits one timing of the protocol. A missing space
+// fits nothing.
+bool IRReceiver::_pairMatches(int index, bool space, const IrProtocol& protocol, IrTimingSlot slot) const {
+#if IR_LIB_SYMBOL_STREAM
+    return (s_symbols.timings[m_pairSymbols[index][space]][protocol.brand] >> slot) & 1;
+#else
+    PulseSpacePair pair = _pair(index);
+    int duration = space ? pair.space : pair.pulse;
+    return duration != -1 && protocol.timing(slot).matches(duration);
+#endif
+}
+
+// --- Capture Recording ---
+// Records the durations of the ring entries from m_captureIndex up to endIndex, writing the
+// header first if this is the start of a burst. Must run before the entries are released.
+void IRReceiver::_recordCapture(uint16_t endIndex, bool burstEnded) {
+    if (m_captureCallback == nullptr && m_captureOutput == nullptr) {
+        m_captureOpen = false;
+        return;
+    }
+    uint16_t index = m_rawTail;
+    if (!m_captureOpen) {
+        uint32_t now = millis();
+        const uint8_t header[IR_CAPTURE_HEADER_SIZE] = {
+            'I', 'R', 'C', IR_CAPTURE_FORMAT_VERSION,
+#if defined(IR_LIB_HOST)
+            IR_PLATFORM_HOST,
+#elif defined(__AVR__)
+            IR_PLATFORM_AVR,
+#elif defined(ESP8266)
+            IR_PLATFORM_ESP8266,
+#elif defined(ESP32)
+            IR_PLATFORM_ESP32,
+#elif defined(ARDUINO_ARCH_STM32)
+            IR_PLATFORM_STM32,
+#else
+            IR_PLATFORM_UNKNOWN,
+#endif
+            (uint8_t)m_irPin,
+            IR_LIB_COMPACT_DURATIONS ? IR_CAPTURE_FLAG_SATURATED : 0,
+            (uint8_t)now, (uint8_t)(now >> 8), (uint8_t)(now >> 16), (uint8_t)(now >> 24)
+        };
+        for (uint8_t i = 0; i < IR_CAPTURE_HEADER_SIZE; i++) {
+            _captureByte(header[i]);
         }
+        m_capturePrevValue = m_rawTransitions[index]; // The first edge only starts the first mark
+        m_captureIndex = (index + 1 < IR_LIB_MAX_TRANSITIONS) ? index + 1 : 0;
+        m_captureOpen = true;
+    }
+    while (m_captureIndex != endIndex) {
+        ir_raw_t value = m_rawTransitions[m_captureIndex];
+        uint32_t duration = entryDuration(m_capturePrevValue, value);
+        _captureVarint(duration ? duration : 1);
+        m_capturePrevValue = value;
+        m_captureIndex = (m_captureIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? m_captureIndex + 1 : 0;
+    }
+    if (burstEnded) {
+        _captureByte(0);
+        m_captureOpen = false;
     }
-    if (maxScore == 0) winningBrand = UNKNOWN;
+    _flushCapture();
+}
 
+void IRReceiver::_captureByte(uint8_t value) {
+    m_captureBuffer[m_captureLength++] = value;
+    if (m_captureLength == IR_LIB_CAPTURE_CHUNK) {
+        _flushCapture();
+    }
+}
 
-    Debug(DEBUG_DECODE_SUMMARY, "\nLib Internal Winning Brand: ", brandToString(winningBrand), " (Score: ", maxScore, ")\n");
+// Unsigned LEB128: 7 bits per byte, low bits first, top bit set on all but the last byte.
+void IRReceiver::_captureVarint(uint32_t value) {
+    while (value >= 0x80) {
+        _captureByte((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    _captureByte((uint8_t)value);
+}
 
-    if (winningBrand == UNKNOWN) {
-        Debug(DEBUG_DECODE_SUMMARY, "No definitive winning brand. Cannot decode.\n");
+void IRReceiver::_flushCapture() {
+    if (m_captureLength == 0) {
         return;
     }
-    
-    Debug(DEBUG_BURST, "\nLib Internal: Identifying segments for decoding...\n");
-    int currentSegmentStartPairIndex = 0; 
-    
-    int initialPreambleOffset = 0; 
-    if (this->m_pulseSpacePairCount > 0 && this->m_pulseSpacePairs[0].pulse != -1 && this->m_pulseSpacePairs[0].space != -1) {
-        RemoteBrand preambleMatch = this->matchPreamble(this->m_pulseSpacePairs[0].pulse, this->m_pulseSpacePairs[0].space, false);
-        if (preambleMatch != UNKNOWN && preambleMatch == winningBrand) {
-            initialPreambleOffset = 1; 
+    if (m_captureCallback != nullptr) {
+        m_captureCallback(m_captureBuffer, m_captureLength);
+    }
+    if (m_captureOutput != nullptr) {
+        m_captureOutput->write(m_captureBuffer, m_captureLength);
+    }
+    m_captureLength = 0;
+}
+
+// --- Streaming Decode ---
+enum StreamPhase : uint8_t {
+    STREAM_IDLE = 0,       // Waiting for a preamble mark
+    STREAM_PREAMBLE_SPACE, // Preamble mark seen, waiting for its space
+    STREAM_DATA_MARK,
+    STREAM_DATA_SPACE,
+    STREAM_DITTO_MARK,     // Repeat preamble seen, waiting for the stop mark
+    STREAM_FRAME_GAP       // Frame complete, a repeat frame without preamble may follow
+};
+
+void IRReceiver::_resetStream(uint16_t index) {
+    m_streamIndex = index;
+    m_streamPrevValue = 0;
+    m_streamPrevHighToLow = false;
+    m_streamHasPrev = false;
+    m_streamEmitted = false;
+    for (int i = 0; i < NUM_BRANDS; ++i) {
+        m_streamStates[i].phase = STREAM_IDLE;
+        m_streamStates[i].bitCount = 0;
+        m_streamStates[i].rawBits = 0;
+    }
+}
+
+// Feeds every ring entry from m_streamIndex up to endIndex to the per-protocol decoders.
+// Stops at the first completed frame; the rest of the burst is skipped until it goes idle.
+// With hold events every frame of the burst is decoded.
+void IRReceiver::_streamRawTransitions(uint16_t endIndex) {
+    while (m_streamIndex != endIndex && (!m_streamEmitted || m_holdEventsEnabled)) {
+        ir_raw_t value = m_rawTransitions[m_streamIndex];
+        m_streamIndex = (m_streamIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? m_streamIndex + 1 : 0;
+
+        if (m_streamHasPrev) {
+            int duration = entryDuration(m_streamPrevValue, value);
+            bool isMark = m_streamPrevHighToLow; // Receiver output is active low
+            for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+                StreamResult result = _streamFeed(IR_PROTOCOLS[p], m_streamStates[IR_PROTOCOLS[p].brand], isMark, duration);
+                if (result == STREAM_NO_FRAME) continue;
+                if (m_holdEventsEnabled) {
+                    if (result == STREAM_FRAME) _holdFrame(m_finalResultCode);
+                    else _holdRepeat(IR_PROTOCOLS[p].brand);
+                } else if (result == STREAM_FRAME) {
+                    m_streamEmitted = true;
+                    m_finalResultCode.timestamp = m_lastTransitionMillis;
+                    _queueCode(m_finalResultCode);
+                    break;
+                }
+            }
         }
+        m_streamPrevValue = value;
+        m_streamPrevHighToLow = (value & DIRECTION_FLAG_H_TO_L) != 0;
+        m_streamHasPrev = true;
+    }
+}
+
+// --- Hold Tracking ---
+void IRReceiver::_holdFrame(const DecodedIR& code) {
+    m_streamEmitted = true; // The batch analysis is not needed for this burst
+    if (m_holdActive && code.brand == m_heldCode.brand && code.command == m_heldCode.command && code.address == m_heldCode.address) {
+        _holdRepeat(code.brand);
+        return;
+    }
+    if (m_holdActive) { // A different button without a pause in between
+        _holdRelease();
+    }
+    m_heldCode = code;
+    m_heldCode.repeatCount = 0;
+    m_heldCode.timestamp = m_lastTransitionMillis;
+    m_heldCode.event = IR_EVENT_PRESS;
+    m_holdActive = true;
+    _queueCode(m_heldCode);
+}
+
+// A repeat frame of the protocol, either a full frame with the held code or a data-less one.
+void IRReceiver::_holdRepeat(RemoteBrand brand) {
+    if (!m_holdActive || brand != m_heldCode.brand) {
+        return; // A repeat frame without the frame it repeats carries no code
+    }
+    if (m_heldCode.repeatCount < UINT8_MAX) m_heldCode.repeatCount++;
+    m_heldCode.timestamp = m_lastTransitionMillis;
+    m_heldCode.event = IR_EVENT_REPEAT;
+    _queueCode(m_heldCode);
+}
+
+void IRReceiver::_holdRelease() {
+    m_heldCode.event = IR_EVENT_RELEASE;
+    m_holdActive = false;
+    _queueCode(m_heldCode);
+}
+
+// Advances one protocol's state machine by a single mark or space. Returns STREAM_FRAME and
+// fills m_finalResultCode once the last data bit of a valid frame has been seen, and
+// STREAM_DITTO_FRAME at the end of a data-less repeat frame.
+IRReceiver::StreamResult IRReceiver::_streamFeed(const IrProtocol& protocol, StreamState& state, bool isMark, int duration) {
+    bool pulseWidthCoded = (protocol.encoding == IR_PULSE_WIDTH); // Bit value carried by the mark
+    bool advanced = false;
+    bool bitDecoded = false;
+
+    switch (state.phase) {
+        case STREAM_PREAMBLE_SPACE:
+            if (!isMark && protocol.preambleSpace.matches(duration)) {
+                state.phase = STREAM_DATA_MARK;
+                state.bitCount = 0;
+                state.rawBits = 0;
+                advanced = true;
+            } else if (!isMark && protocol.repeatFrame == IR_REPEAT_DITTO && protocol.repeatPreambleSpace.matches(duration)) {
+                state.phase = STREAM_DITTO_MARK;
+                advanced = true;
+            }
+            break;
+        case STREAM_DITTO_MARK:
+            if (isMark && protocol.fixedTiming.matches(duration)) {
+                state.phase = STREAM_IDLE;
+                Debug(DEBUG_BITS, "  Stream ", protocol.name, " repeat frame.\n");
+                return STREAM_DITTO_FRAME;
+            }
+            break;
+        case STREAM_FRAME_GAP:
+            if (isMark && protocol.fixedTiming.matches(duration)) {
+                advanced = true; // Stop mark of the completed frame
+            } else if (!isMark && duration >= MIN_REPEAT_GAP) {
+                state.phase = STREAM_DATA_MARK; // The repeat frame starts straight with data
+                state.bitCount = 0;
+                state.rawBits = 0;
+                advanced = true;
+            }
+            break;
+        case STREAM_DATA_MARK:
+        case STREAM_DATA_SPACE:
+            if (isMark == (state.phase == STREAM_DATA_MARK)) {
+                if (isMark != pulseWidthCoded) { // The duration that is the same for every bit
+                    advanced = protocol.fixedTiming.matches(duration);
+                } else {
+                    advanced = bitDecoded = true;
+                    if (protocol.oneTiming.matches(duration)) state.rawBits |= (1UL << state.bitCount);
+                    else if (!protocol.zeroTiming.matches(duration)) advanced = bitDecoded = false;
+                }
+                if (advanced) state.phase = isMark ? STREAM_DATA_SPACE : STREAM_DATA_MARK;
+            }
+            break;
+        case STREAM_IDLE:
+        default:
+            break;
     }
 
-    int dataStartForCurrentSegment = initialPreambleOffset; 
-    bool segmentChecksums[IR_LIB_MAX_DECODED_SEGMENTS] = {false}; // For NEC checksums
+    if (bitDecoded && ++state.bitCount == protocol.dataBits) {
+        state.phase = (protocol.repeatFrame == IR_REPEAT_NO_PREAMBLE) ? STREAM_FRAME_GAP : STREAM_IDLE;
+        DecodedFrameInternal frame = this->fieldsFromBits(protocol, state.rawBits, state.bitCount);
+        if ((protocol.fieldFlags & IR_FIELD_COMMAND_INVERTED) && !frame.checksumValid) {
+            Debug(DEBUG_BITS, "  Stream ", protocol.name, " frame failed checksum, leaving it to batch analysis.\n");
+            Trace(IR_TRACE_STREAM_CHECKSUM, protocol.brand, frame.base.command, 0);
+            return STREAM_NO_FRAME;
+        }
+        Debug(DEBUG_DECODE_SUMMARY, "\nStream Decoded ", protocol.name, " - Command: ", frame.base.command, ", Address: ", frame.base.address, "\n");
+        Trace(IR_TRACE_STREAM_CODE, protocol.brand, frame.base.command, frame.base.address);
+        this->m_finalResultCode = frame.base;
+        this->m_finalResultCode.checksumValid = frame.checksumValid;
+        return STREAM_FRAME;
+    }
+    if (advanced) {
+        return STREAM_NO_FRAME;
+    }
 
-    for (int i = 0; i < this->m_pulseSpacePairCount && this->m_decodedSegmentCount < IR_LIB_MAX_DECODED_SEGMENTS; ++i) {
-        bool isSegmentEnd = false;
-        int brand_repeat_delay = 0; 
+    // Mismatch: drop the partial frame, the current mark may itself start a new one
+    bool preambleMark = isMark && (protocol.preamblePulse.matches(duration) ||
+                                   (protocol.repeatFrame == IR_REPEAT_DITTO && protocol.repeatPreamblePulse.matches(duration)));
+    state.phase = preambleMark ? STREAM_PREAMBLE_SPACE : STREAM_IDLE;
+    return STREAM_NO_FRAME;
+}
 
-        if (winningBrand == SONY) brand_repeat_delay = SONY_REPEAT_DELAY;
-        else if (winningBrand == NEC) brand_repeat_delay = NEC_REPEAT_DELAY;
-        else if (winningBrand == JVC) brand_repeat_delay = JVC_REPEAT_DELAY;
+// Splits the pairs of this analysis pass into frames in a single pass. Every space of at
+// least MIN_REPEAT_GAP (or a missing final space) ends a segment; the preamble class and the
+// mark/space spread of each segment are recorded so no scorer has to walk the pairs again.
+void IRReceiver::_segmentBurst() {
+    m_segmentCount = 0;
+    BurstSegment* segment = nullptr;
+
+    for (int i = 0; i < m_pulseSpacePairCount; ++i) {
+        PulseSpacePair pair = _pair(i);
+
+        if (segment == nullptr) { // First pair of a new segment
+            if (m_segmentCount >= IR_LIB_MAX_SEGMENTS) {
+                Debug(DEBUG_BURST, "Warning: Exceeded segment index, ignoring pairs from ", i, " on.\n");
+                Trace(IR_TRACE_SEGMENTS_FULL, UNKNOWN, i, 0);
+                break;
+            }
+            segment = &m_segments[m_segmentCount];
+            segment->start = i;
+            segment->preamble = UNKNOWN;
+            segment->minMark = INT_MAX; segment->maxMark = INT_MIN;
+            segment->minSpace = INT_MAX; segment->maxSpace = INT_MIN;
+            if (pair.pulse != -1 && pair.space != -1) {
+                segment->preamble = this->matchPreamble(i, m_burstFrameCount + m_segmentCount > 0);
+            }
+        }
 
-        if (brand_repeat_delay > 0 && this->m_pulseSpacePairs[i].space != -1 && this->isWithinTolerance(this->m_pulseSpacePairs[i].space, brand_repeat_delay, 5000)) {
-            isSegmentEnd = true;
-        } else if (i == this->m_pulseSpacePairCount - 1) {
-            isSegmentEnd = true;
+        bool isSegmentEnd = (pair.space == -1 || pair.space >= MIN_REPEAT_GAP || i == m_pulseSpacePairCount - 1);
+        bool isPreamblePair = (i == segment->start && segment->preamble != UNKNOWN);
+        if (!isPreamblePair) {
+            if (pair.pulse < segment->minMark) segment->minMark = pair.pulse;
+            if (pair.pulse > segment->maxMark) segment->maxMark = pair.pulse;
+            if (pair.space != -1 && pair.space < MIN_REPEAT_GAP) {
+                if (pair.space < segment->minSpace) segment->minSpace = pair.space;
+                if (pair.space > segment->maxSpace) segment->maxSpace = pair.space;
+            }
         }
 
         if (isSegmentEnd) {
-            const PulseSpacePair* segmentDataPtr = this->m_pulseSpacePairs + currentSegmentStartPairIndex + dataStartForCurrentSegment;
-            int numDataPairsInSegment = (i - (currentSegmentStartPairIndex + dataStartForCurrentSegment)) + 1;
-
-            if (numDataPairsInSegment > 0) {
-                if (winningBrand == NEC) {
-                    DecodedNECInternal necResult = decodeNECData(segmentDataPtr, numDataPairsInSegment);
-                    this->m_decodedSegments[this->m_decodedSegmentCount] = necResult.base;
-                    segmentChecksums[this->m_decodedSegmentCount] = necResult.checksumValid;
-                } else {
-                    this->m_decodedSegments[this->m_decodedSegmentCount] = this->decodeWinningSegment(winningBrand, segmentDataPtr, numDataPairsInSegment);
-                    // segmentChecksums remains false for non-NEC
-                }
+            segment->end = i;
+            Debug(DEBUG_BURST, "  Segment ", m_segmentCount + 1, ": Pairs ", segment->start, "-", segment->end, ", Preamble: ", brandToString(segment->preamble), "\n");
+            m_segmentCount++;
+            segment = nullptr;
+        }
+    }
+}
 
-                if(this->m_decodedSegments[this->m_decodedSegmentCount].brand != UNKNOWN) { // Ensure decode function set the brand
-                    this->m_decodedSegmentCount++;
-                }
+void IRReceiver::_resetBurst(uint16_t index) {
+    for (int i = 0; i < NUM_BRANDS; ++i) {
+        m_brandScores[i] = 0;
+        m_frameVoteCount[i] = 0;
+        m_dittoFrames[i] = 0;
+        m_agreeingFrames[i] = 0;
+    }
+    m_burstFrameCount = 0;
+    m_burstLastGap = -1;
+    m_gapBeforePass = -1;
+    m_burstAnalysisMicros = 0;
+#if IR_LIB_LEARNED_CODES > 0
+    m_burstFingerprint = 0;
+#endif
+    m_dispatchBrand = UNKNOWN;
+    m_dispatchActive = (IR_LIB_EARLY_DISPATCH != 0);
+    m_frameScanIndex = index;
+    m_frameScanPrevValue = 0;
+    m_frameScanHasPrev = false;
+}
+
+// Scans the ring from m_frameScanIndex up to endIndex for spaces of at least MIN_REPEAT_GAP.
+// Returns true with the entry that ends the latest such gap, i.e. every frame before it is complete.
+bool IRReceiver::_findFrameBoundary(uint16_t endIndex, uint16_t& boundary) {
+    bool found = false;
+    while (m_frameScanIndex != endIndex) {
+        ir_raw_t value = m_rawTransitions[m_frameScanIndex];
+        if (m_frameScanHasPrev && (value & DIRECTION_FLAG_H_TO_L) && entryDuration(m_frameScanPrevValue, value) >= (uint32_t)MIN_REPEAT_GAP) {
+            boundary = m_frameScanIndex;
+            found = true;
+        }
+        m_frameScanPrevValue = value;
+        m_frameScanHasPrev = true;
+        m_frameScanIndex = (m_frameScanIndex + 1 < IR_LIB_MAX_TRANSITIONS) ? m_frameScanIndex + 1 : 0;
+    }
+    return found;
+}
+
+// One analysis pass over the complete frames between startIndex and endIndex: adds their
+// scores to the burst totals and tallies their decoded codes for every protocol that scored.
+void IRReceiver::_analyzeFrames(uint16_t startIndex, uint16_t endIndex) {
+    Debug(DEBUG_BURST, "\n--- Lib Internal: analyzeFrames ---\n"); 
+    this->_processRawTransitionsToPairs(startIndex, endIndex);
+
+    if (this->m_pulseSpacePairCount == 0) {
+        Debug(DEBUG_BURST, "No pulse/space pairs extracted from frames.\n");
+        return;
+    }
+    Debug(DEBUG_BURST, "Number of pulse/space pairs extracted: ", m_pulseSpacePairCount, "\n");
+    Trace(IR_TRACE_FRAMES, UNKNOWN, m_pulseSpacePairCount, m_burstFrameCount);
+
+#ifdef DEBUG_BURST 
+    if((DEBUG & DEBUG_BURST) == DEBUG_BURST) { 
+        Debug(DEBUG_BURST, "Pulse/Space Pairs (us):\n");
+        for (int i = 0; i < m_pulseSpacePairCount; ++i) {
+            PulseSpacePair pair = _pair(i);
+            if (pair.space == -1) Debug(DEBUG_BURST, "  Pair ", i, ": Pulse=", pair.pulse, ", Space=MISSING\n");
+            else Debug(DEBUG_BURST, "  Pair ", i, ": Pulse=", pair.pulse, ", Space=", pair.space, "\n");
+        }
+    }
+#endif
+
+    this->_segmentBurst();
+    this->m_gapBeforePass = this->m_burstLastGap; // Read by scoreProtocol() for the first frame
+    this->m_burstLastGap = (this->m_segmentCount > 0) ? this->_segmentGap(this->m_segments[this->m_segmentCount - 1]) : -1;
+#if IR_LIB_LEARNED_CODES > 0
+    if (this->m_burstFingerprint == 0) { // Before the gate: unknown protocols look like noise to it
+        this->m_burstFingerprint = this->_fingerprintPass();
+    }
+#endif
+
+    if (!this->_plausiblePass()) {
+        Debug(DEBUG_BURST, "No frame in this pass looks like any protocol, skipping scoring.\n");
+        Trace(IR_TRACE_NOISE, UNKNOWN, m_pulseSpacePairCount, m_segmentCount);
+        if (m_stats.noisePasses < UINT32_MAX) m_stats.noisePasses++;
+        return;
+    }
+    if (this->_dispatchPass()) {
+        return;
+    }
+
+    Debug(DEBUG_BRAND, "\n--- Lib Internal: Scoring Brands ---\n");
+    for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+        int score = this->scoreProtocol(IR_PROTOCOLS[p], this->m_segments, this->m_segmentCount);
+        this->m_brandScores[IR_PROTOCOLS[p].brand] += score;
+        if (score > 0) {
+            this->_voteFrames(IR_PROTOCOLS[p]);
+        }
+    }
+    int frameCount = this->m_burstFrameCount + this->m_segmentCount;
+    this->m_burstFrameCount = frameCount < UINT8_MAX ? frameCount : UINT8_MAX;
+}
+
+// Cheap check that the pass can be a remote at all, so noise bursts never reach scoring: some
+// frame must open with a preamble, or have about as many pairs as a protocol's frames and the
+// fixed marks or fixed spaces every bit encoding has. Rejected passes leave the burst totals
+// alone, so frames that follow still count as the first one.
+bool IRReceiver::_plausiblePass() const {
+    for (int s = 0; s < this->m_segmentCount; ++s) {
+        if (this->m_segments[s].preamble != UNKNOWN) {
+            return true;
+        }
+        SegmentView view = this->viewSegment(this->m_segments[s], UNKNOWN);
+        if (!view.marksFixed && !view.spacesFixed) {
+            continue;
+        }
+        for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+            const IrProtocol& protocol = IR_PROTOCOLS[p];
+            if (this->isWithinTolerance(view.pairCount, protocol.dataBits, 2)) {
+                return true;
+            }
+            if (protocol.repeatFrame == IR_REPEAT_NO_PREAMBLE && this->isWithinTolerance(view.pairCount, protocol.repeatDataPairs, 2)) {
+                return true;
             }
+        }
+    }
+    return false;
+}
 
-            currentSegmentStartPairIndex = i + 1; 
-            dataStartForCurrentSegment = 0; 
+// Early dispatch: scores this pass for one expected protocol only, and keeps that result when
+// every frame fits the protocol perfectly. The candidate is the protocol whose preamble opens
+// the pass, else the one earlier passes of this burst went to, else the last winner. No other
+// protocol can earn a preamble point on these frames, so each scores at most 2 per frame while
+// a perfect candidate scores at least 2, and 3 on the initial frame: full scoring would pick
+// the same winner. Returns false, and turns dispatch off for the burst, when full scoring is needed.
+bool IRReceiver::_dispatchPass() {
+    if (!this->m_dispatchActive || this->m_segmentCount == 0) {
+        return false;
+    }
+    this->m_dispatchActive = false; // Until this pass succeeds
+    RemoteBrand brand = this->m_segments[0].preamble;
+    if (brand == UNKNOWN) {
+        brand = (this->m_dispatchBrand != UNKNOWN) ? this->m_dispatchBrand : this->m_lastWinnerBrand;
+    }
+    const IrProtocol* protocol = findProtocol(brand);
+    if (protocol == nullptr || (this->m_dispatchBrand != UNKNOWN && brand != this->m_dispatchBrand)) {
+        return false;
+    }
+    for (int s = 0; s < this->m_segmentCount; ++s) {
+        if (this->m_segments[s].preamble != UNKNOWN && this->m_segments[s].preamble != brand) {
+            return false; // Another protocol's frame is in the pass
+        }
+    }
+    int score = this->scoreProtocol(*protocol, this->m_segments, this->m_segmentCount);
+    if (score != this->maxProtocolScore(*protocol, this->m_segmentCount)) {
+        Debug(DEBUG_BRAND, "Early dispatch to ", protocol->name, " missed (Score: ", score, "), scoring all protocols.\n");
+        return false;
+    }
+    Debug(DEBUG_BRAND, "Early dispatch to ", protocol->name, " (Score: ", score, ").\n");
+    this->m_brandScores[brand] += score;
+    this->_voteFrames(*protocol);
+    int frameCount = this->m_burstFrameCount + this->m_segmentCount;
+    this->m_burstFrameCount = frameCount < UINT8_MAX ? frameCount : UINT8_MAX;
+    this->m_dispatchBrand = brand;
+    this->m_dispatchActive = true;
+    if (this->m_stats.fastPathPasses < UINT32_MAX) this->m_stats.fastPathPasses++;
+    return true;
+}
 
-            if (currentSegmentStartPairIndex < this->m_pulseSpacePairCount &&
-                this->m_pulseSpacePairs[currentSegmentStartPairIndex].pulse != -1 &&
-                this->m_pulseSpacePairs[currentSegmentStartPairIndex].space != -1) {
-                if (this->matchPreamble(this->m_pulseSpacePairs[currentSegmentStartPairIndex].pulse, this->m_pulseSpacePairs[currentSegmentStartPairIndex].space, true) == winningBrand) {
-                    dataStartForCurrentSegment = 1; 
-                }
+// Decodes the frames of this pass as the given protocol and tallies each distinct code.
+void IRReceiver::_voteFrames(const IrProtocol& protocol) {
+    Debug(DEBUG_BURST, "\nLib Internal: Decoding segments as ", protocol.name, "...\n");
+    FrameVote* votes = this->m_frameVotes[protocol.brand];
+    uint8_t& voteCount = this->m_frameVoteCount[protocol.brand];
+
+    for (int s = 0; s < this->m_segmentCount; ++s) {
+        if (this->m_burstFrameCount + s > 0 && protocol.repeatFrame == IR_REPEAT_DITTO) { // Later frames carry no data
+            if (this->m_segments[s].preamble == protocol.brand && this->m_dittoFrames[protocol.brand] < UINT8_MAX) {
+                this->m_dittoFrames[protocol.brand]++;
             }
+            continue;
+        }
+        SegmentView view = this->viewSegment(this->m_segments[s], protocol.brand);
+        if (view.dataCount <= 0) continue;
+
+        DecodedFrameInternal frame = this->decodeSegment(protocol, view.dataStart, view.dataCount);
+        if (frame.base.command == -1) { // Only valid decodes take part in the vote
+            this->m_agreeingFrames[protocol.brand] = 0;
+            continue;
+        }
+        if ((protocol.fieldFlags & IR_FIELD_COMMAND_INVERTED) && !frame.checksumValid && m_stats.checksumFailures < UINT16_MAX) {
+            m_stats.checksumFailures++;
+        }
+
+        int found = -1;
+        for (int v = 0; v < voteCount; ++v) { // Checksum is part of uniqueness
+            if (votes[v].command == frame.base.command && votes[v].address == frame.base.address && votes[v].checksumValid == frame.checksumValid) {
+                if (votes[v].count < UINT8_MAX) votes[v].count++;
+                found = v;
+                break;
+            }
+        }
+        if (found == -1 && voteCount < IR_LIB_MAX_FRAME_VOTES) {
+            votes[voteCount].command = frame.base.command;
+            votes[voteCount].address = frame.base.address;
+            votes[voteCount].count = 1;
+            votes[voteCount].checksumValid = frame.checksumValid;
+            found = voteCount++;
+        }
+
+        uint8_t& agreeing = this->m_agreeingFrames[protocol.brand];
+        if (found == -1) {
+            agreeing = 0;
+        } else if (agreeing > 0 && this->m_agreeingVote[protocol.brand] == found) {
+            if (agreeing < UINT8_MAX) agreeing++;
+        } else {
+            agreeing = 1;
+            this->m_agreeingVote[protocol.brand] = found;
         }
     }
+}
+
+// Picks the best scoring protocol over the whole burst and queues its most frequent code.
+void IRReceiver::_finishBurst() {
+    this->m_finalResultCode = DecodedIR(); 
+
+    Debug(DEBUG_BRAND, "\n--- Lib Internal: Remote Brand Scores (Final) ---\n");
+    for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+        Debug(DEBUG_BRAND, IR_PROTOCOLS[p].name, " Score: ", this->m_brandScores[IR_PROTOCOLS[p].brand], "\n");
+    }
+    Debug(DEBUG_BRAND, "-----------------------------------\n");
+
+    int maxScore = 0;
+    RemoteBrand winningBrand = this->_leadingBrand(maxScore);
+
+    Debug(DEBUG_DECODE_SUMMARY, "\nLib Internal Winning Brand: ", brandToString(winningBrand), " (Score: ", maxScore, ")\n");
 
-    if (this->m_decodedSegmentCount > 0) {
-        this->determineWinner(this->m_decodedSegments, this->m_decodedSegmentCount, segmentChecksums); 
-        if (this->m_finalResultCode.brand != UNKNOWN && this->m_finalResultCode.command != -1) {
-            this->m_codeResultIsReady = true;
+    if (winningBrand == UNKNOWN) {
+        Debug(DEBUG_DECODE_SUMMARY, "No definitive winning brand. Cannot decode.\n");
+        Trace(IR_TRACE_NO_WINNER, UNKNOWN, 0, 0);
+#if IR_LIB_LEARNED_CODES > 0
+        this->_finishLearnedBurst();
+#endif
+        return;
+    }
+    Trace(IR_TRACE_WINNER, winningBrand, maxScore, 0);
+
+    if (this->m_frameVoteCount[winningBrand] == 0) {
+        Debug(DEBUG_DECODE_SUMMARY, "No segments decoded for the winning brand.\n");
+        Trace(IR_TRACE_NO_WINNER, winningBrand, 0, 0);
+#if IR_LIB_LEARNED_CODES > 0
+        this->_finishLearnedBurst();
+#endif
+        return;
+    }
+
+    this->determineWinner(winningBrand, this->m_frameVotes[winningBrand], this->m_frameVoteCount[winningBrand]);
+    if (this->m_finalResultCode.brand != UNKNOWN && this->m_finalResultCode.command != -1) {
+        int repeats = this->m_finalResultCode.repeatCount + this->m_dittoFrames[winningBrand]; // Ditto frames were not decoded
+        this->m_finalResultCode.repeatCount = repeats < UINT8_MAX ? repeats : UINT8_MAX;
+        this->_queueBurstCode();
+    }
+#if IR_LIB_LEARNED_CODES > 0
+    else {
+        this->_finishLearnedBurst();
+    }
+#endif
+}
+
+// Best scoring protocol of the burst so far (ties go to the lower RemoteBrand), UNKNOWN
+// while nothing scored.
+RemoteBrand IRReceiver::_leadingBrand(int& score) const {
+    RemoteBrand brand = UNKNOWN;
+    score = 0;
+    for (int i = 1; i < NUM_BRANDS; ++i) {
+        if (this->m_brandScores[i] > score) {
+            score = this->m_brandScores[i];
+            brand = (RemoteBrand)i;
         }
+    }
+    return brand;
+}
+
+// Runs after each pass that ended on a frame gap. Publishes the code of the leading protocol
+// once its last m_earlyCommitFrames decoded frames were identical, or its last frame passed
+// the inverted command check, instead of waiting IR_LIB_IDLE_TIMEOUT_MS for the burst to end.
+// The burst is then treated like a streamed one: later frames are skipped, or go to the hold
+// tracker when hold events are on.
+void IRReceiver::_commitBurst() {
+    if (this->m_earlyCommitFrames == 0 || this->m_streamEmitted) {
+        return;
+    }
+    int score;
+    RemoteBrand brand = this->_leadingBrand(score);
+    if (brand == UNKNOWN || this->m_agreeingFrames[brand] == 0) {
+        return;
+    }
+    const IrProtocol* protocol = findProtocol(brand);
+    const FrameVote& vote = this->m_frameVotes[brand][this->m_agreeingVote[brand]];
+    bool checksumPassed = (protocol->fieldFlags & IR_FIELD_COMMAND_INVERTED) && vote.checksumValid;
+    if (this->m_agreeingFrames[brand] < this->m_earlyCommitFrames && !checksumPassed) {
+        return;
+    }
+
+    this->m_finalResultCode = DecodedIR();
+    this->m_finalResultCode.brand = brand;
+    this->m_finalResultCode.command = vote.command;
+    this->m_finalResultCode.address = vote.address;
+    this->m_finalResultCode.checksumValid = vote.checksumValid;
+    int repeats = vote.count - 1 + this->m_dittoFrames[brand];
+    this->m_finalResultCode.repeatCount = repeats < UINT8_MAX ? repeats : UINT8_MAX;
+    this->m_finalResultCode.timestamp = this->m_lastTransitionMillis;
+    Debug(DEBUG_DECODE_SUMMARY, "Early commit to ", protocol->name, " after ", this->m_agreeingFrames[brand], " agreeing frame(s), Command: ", vote.command, "\n");
+    Trace(IR_TRACE_COMMIT, brand, vote.command, this->m_agreeingFrames[brand]);
+    if (this->m_holdEventsEnabled) {
+        this->_holdFrame(this->m_finalResultCode); // Later frames arrive as repeats through the stream decoders
     } else {
-         Debug(DEBUG_DECODE_SUMMARY, "No segments decoded for the winning brand (after loop).\n");
+        this->m_streamEmitted = true;
+        this->_queueCode(this->m_finalResultCode);
+    }
+}
+
+// Queues m_finalResultCode for the burst that just ended.
+void IRReceiver::_queueBurstCode() {
+    this->m_finalResultCode.timestamp = this->m_lastTransitionMillis;
+    if (this->m_holdEventsEnabled) { // Only resolved after the burst ended: press and release at once
+        this->m_finalResultCode.event = IR_EVENT_PRESS;
+        this->_queueCode(this->m_finalResultCode);
+        this->m_finalResultCode.event = IR_EVENT_RELEASE;
     }
+    this->_queueCode(this->m_finalResultCode);
 }
 
 // --- Helper, Scoring, and Decoding Methods ---
-// (isWithinTolerance, isWithinPercentageTolerance, matchPreamble, scoreSonySIRC12, scoreJVC, scoreNEC - are the same as before)
-// ... (These functions would be here, unchanged from the previous correct version) ...
 bool IRReceiver::isWithinTolerance(int captured, int expected, int tolerance) const {
   return abs(captured - expected) <= tolerance;
 }
 
-bool IRReceiver::isWithinPercentageTolerance(int captured, int expected, float tolerance_percent) const {
-    if (expected == 0) return captured == 0;
-    return abs(captured - expected) <= (expected * tolerance_percent);
+
+const IrProtocol* IRReceiver::findProtocol(RemoteBrand brand) {
+    for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+        if (IR_PROTOCOLS[p].brand == brand) return &IR_PROTOCOLS[p];
+    }
+    return nullptr;
 }
 
-RemoteBrand IRReceiver::matchPreamble(int pulse, int space, bool isRepeatPreamble) const {
-  if (isRepeatPreamble) {
-      if (this->isWithinTolerance(pulse, JVC_REPEAT_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, JVC_REPEAT_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return JVC;
-      }
-      if (this->isWithinTolerance(pulse, SONY_REPEAT_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, SONY_REPEAT_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return SONY;
-      }
-      if (this->isWithinTolerance(pulse, NEC_REPEAT_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, NEC_REPEAT_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return NEC;
-      }
-  } else {
-      if (this->isWithinTolerance(pulse, JVC_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, JVC_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return JVC;
-      }
-      if (this->isWithinTolerance(pulse, SONY_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, SONY_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return SONY;
+RemoteBrand IRReceiver::matchPreamble(int index, bool isRepeatPreamble) const {
+  for (size_t p = 0; p < IR_PROTOCOLS_COUNT; ++p) {
+      const IrProtocol& protocol = IR_PROTOCOLS[p];
+      IrTimingSlot expectedPulse = IR_SLOT_PREAMBLE_PULSE;
+      IrTimingSlot expectedSpace = IR_SLOT_PREAMBLE_SPACE;
+      if (isRepeatPreamble) {
+          if (protocol.repeatFrame == IR_REPEAT_NO_PREAMBLE) continue;
+          expectedPulse = IR_SLOT_REPEAT_PULSE;
+          expectedSpace = IR_SLOT_REPEAT_SPACE;
       }
-      if (this->isWithinTolerance(pulse, NEC_PREAMBLE_PULSE, TIMING_TOLERANCE) &&
-          this->isWithinTolerance(space, NEC_PREAMBLE_SPACE, TIMING_TOLERANCE)) {
-        return NEC;
+      if (this->_pairMatches(index, false, protocol, expectedPulse) && this->_pairMatches(index, true, protocol, expectedSpace)) {
+        return protocol.brand;
       }
   }
   return UNKNOWN;
 }
 
-int IRReceiver::scoreSonySIRC12(const PulseSpacePair pairs[], int count) const {
-    int score = 0;
-    Debug(DEBUG_BRAND, "\nScoring for SONY SIRC-12...\n");
+IRReceiver::SegmentView IRReceiver::viewSegment(const BurstSegment& segment, RemoteBrand brand) const {
+    SegmentView view;
+    int minMark = segment.minMark, maxMark = segment.maxMark;
+    int minSpace = segment.minSpace, maxSpace = segment.maxSpace;
+
+    view.pairCount = segment.end - segment.start + 1;
+    view.hasPreamble = (segment.preamble != UNKNOWN && segment.preamble == brand);
+    view.dataStart = segment.start + (view.hasPreamble ? 1 : 0);
+    view.dataCount = segment.end - view.dataStart + 1;
+
+    if (segment.preamble != UNKNOWN && !view.hasPreamble) { // Another protocol's preamble is data here
+        PulseSpacePair first = _pair(segment.start);
+        if (first.pulse < minMark) minMark = first.pulse;
+        if (first.pulse > maxMark) maxMark = first.pulse;
+        if (first.space < minSpace) minSpace = first.space;
+        if (first.space > maxSpace) maxSpace = first.space;
+    }
+    view.marksFixed = (minMark <= maxMark) && (maxMark - minMark <= 2 * TIMING_TOLERANCE);
+    view.spacesFixed = (minSpace <= maxSpace) && (maxSpace - minSpace <= 2 * TIMING_TOLERANCE);
+    return view;
+}
 
-    if (count == 0) return 0;
+// Space that ends a segment when another frame follows it, -1 when the burst ended there.
+int IRReceiver::_segmentGap(const BurstSegment& segment) const {
+    int space = this->_pair(segment.end).space;
+    return (space >= MIN_REPEAT_GAP) ? space : -1;
+}
 
-    int currentSegmentStartPairIndex = 0;
-    int segmentCount = 0;
+// Whether a gap between two frames fits the protocol's repeat timing. A compact ring stores
+// gaps of 32.767 ms and longer as TIME_VALUE_MASK, which fits any window reaching that far.
+bool IRReceiver::_repeatGapMatches(const IrProtocol& protocol, int gapMicros) const {
+    if (gapMicros < 0) return true; // Not seen, e.g. the burst started mid-hold
+    int gapMs = gapMicros / 1000;
+    if (IR_LIB_COMPACT_DURATIONS && gapMicros >= (int)TIME_VALUE_MASK) {
+        return protocol.repeatGapMs.max >= gapMs;
+    }
+    return protocol.repeatGapMs.matches(gapMs);
+}
 
-    for (int i = 0; i < count; ++i) {
-        bool isSegmentEnd = false;
-        if ((pairs[i].space != -1 && this->isWithinTolerance(pairs[i].space, SONY_REPEAT_DELAY, 5000)) || i == count - 1) {
-             isSegmentEnd = true;
+// Scores how well the segmented burst fits one protocol descriptor. Each frame earns a point
+// for its preamble (when the frame type has one), for a data pair count close to the expected
+// one, and for the mark/space structure of the protocol's bit encoding. A repeat frame that
+// follows the previous frame after a gap outside the protocol's repeat timing earns nothing.
+int IRReceiver::scoreProtocol(const IrProtocol& protocol, const BurstSegment segments[], int count) const {
+    int score = 0;
+    Debug(DEBUG_BRAND, "\nScoring for ", protocol.name, "...\n");
+
+    for (int s = 0; s < count; ++s) {
+        SegmentView view = this->viewSegment(segments[s], protocol.brand);
+        int segmentNumber = m_burstFrameCount + s + 1;
+        bool isInitialFrame = (m_burstFrameCount + s == 0);
+        bool framePreamble = isInitialFrame || protocol.repeatFrame != IR_REPEAT_NO_PREAMBLE;
+        bool frameCarriesData = isInitialFrame || protocol.repeatFrame != IR_REPEAT_DITTO;
+        Debug(DEBUG_BRAND, "  Detected ", protocol.name, " Segment ", segmentNumber, " (Pairs: ", view.pairCount, ")\n");
+        if (!isInitialFrame) {
+            int gap = (s > 0) ? this->_segmentGap(segments[s - 1]) : this->m_gapBeforePass;
+            if (!this->_repeatGapMatches(protocol, gap)) {
+                Debug(DEBUG_BRAND, "    +0: Repeat Gap (", gap, " us) outside ", protocol.name, " timing before Segment ", segmentNumber, ".\n");
+                continue;
+            }
         }
 
-        if (isSegmentEnd) {
-            int segmentEndPairIndex = i;
-            int segmentPairCount = segmentEndPairIndex - currentSegmentStartPairIndex + 1;
-
-            if (segmentPairCount > 0) {
-                segmentCount++;
-                Debug(DEBUG_BRAND, "  Detected SONY Segment ", segmentCount, " (Pairs: ", segmentPairCount, ")\n");
-
-                int segmentDataPairsStartIndex = currentSegmentStartPairIndex;
-                bool isInitialFrame = (segmentCount == 1);
-
-                if (segmentPairCount > 0 && pairs[currentSegmentStartPairIndex].space != -1) {
-                    RemoteBrand preambleMatch = this->matchPreamble(pairs[currentSegmentStartPairIndex].pulse, pairs[currentSegmentStartPairIndex].space, !isInitialFrame);
-                    if (isInitialFrame && preambleMatch == SONY) {
-                         score++; Debug(DEBUG_BRAND, "    +1: Initial SONY Preamble Match in Segment 1.\n");
-                         segmentDataPairsStartIndex = currentSegmentStartPairIndex + 1;
-                    } else if (!isInitialFrame && preambleMatch == SONY) {
-                         score++; Debug(DEBUG_BRAND, "    +1: Repeat SONY Preamble Match in Segment ", segmentCount, ".\n");
-                         segmentDataPairsStartIndex = currentSegmentStartPairIndex + 1;
-                    } else if (isInitialFrame) Debug(DEBUG_BRAND, "    +0: Initial SONY Preamble Mismatch in Segment 1.\n");
-                    else Debug(DEBUG_BRAND, "    +0: Repeat SONY Preamble Mismatch in Segment ", segmentCount, ".\n");
-                } else Debug(DEBUG_BRAND, "    +0: Segment ", segmentCount, " does not start with a valid pulse/space pair for preamble check.\n");
-
-                int dataPairCountInSegment = segmentEndPairIndex - segmentDataPairsStartIndex + 1;
-                if (dataPairCountInSegment > 0) {
-                    if (isInitialFrame) {
-                        if (this->isWithinTolerance(dataPairCountInSegment, SONY_INITIAL_BITS - 1, 2)) {
-                            score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", dataPairCountInSegment, ") close to expected SONY initial frame data length (", SONY_INITIAL_BITS - 1, ") in Segment 1.\n");
-                        } else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", dataPairCountInSegment, ") not close to expected SONY initial frame data length (", SONY_INITIAL_BITS - 1, ") in Segment 1.\n");
-                    } else {
-                         if (this->isWithinTolerance(dataPairCountInSegment, SONY_REPEAT_BITS - 1, 2)) {
-                            score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", dataPairCountInSegment, ") close to expected SONY repeat frame data length (", SONY_REPEAT_BITS - 1, ") in Segment ", segmentCount, ".\n");
-                         } else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", dataPairCountInSegment, ") not close to expected SONY repeat frame data length (", SONY_REPEAT_BITS - 1, ") in Segment ", segmentCount, ".\n");
-                    }
+        if (framePreamble) {
+            if (view.hasPreamble) {
+                score++; Debug(DEBUG_BRAND, "    +1: ", isInitialFrame ? "Initial" : "Repeat", " Preamble Match in Segment ", segmentNumber, ".\n");
+            } else Debug(DEBUG_BRAND, "    +0: ", isInitialFrame ? "Initial" : "Repeat", " Preamble Mismatch in Segment ", segmentNumber, ".\n");
+        }
 
-                    if (dataPairCountInSegment > 1) {
-                         bool marksAreVariable = false; bool spacesAreFixed = true;
-                         int firstDataMark = pairs[segmentDataPairsStartIndex].pulse;
-                         bool allMarksFixed = true;
-                         for (int j = segmentDataPairsStartIndex + 1; j <= segmentEndPairIndex; ++j) {
-                             if (!this->isWithinTolerance(pairs[j].pulse, firstDataMark, TIMING_TOLERANCE)) { allMarksFixed = false; break; }
-                         }
-                         if (!allMarksFixed) marksAreVariable = true;
-
-                         int firstValidDataSpace = -1;
-                         for(int j = segmentDataPairsStartIndex; j <= segmentEndPairIndex; ++j) {
-                             if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, SONY_REPEAT_DELAY, 5000)) { firstValidDataSpace = pairs[j].space; break; }
-                         }
-                         if (firstValidDataSpace != -1) {
-                             for (int j = segmentDataPairsStartIndex; j <= segmentEndPairIndex; ++j) {
-                                 if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, SONY_REPEAT_DELAY, 5000)) {
-                                     if (!this->isWithinTolerance(pairs[j].space, firstValidDataSpace, TIMING_TOLERANCE)) { spacesAreFixed = false; break; }
-                                 } else if (pairs[j].space != -1 && this->isWithinTolerance(pairs[j].space, SONY_REPEAT_DELAY, 5000) && j != segmentEndPairIndex) {
-                                     spacesAreFixed = false; break;
-                                 }
-                             }
-                         } else spacesAreFixed = false;
-
-                         if (marksAreVariable && spacesAreFixed) {
-                             score++; Debug(DEBUG_BRAND, "    +1: Variable Mark / Fixed Space Structure Match in Segment ", segmentCount, ".\n");
-                         } else Debug(DEBUG_BRAND, "    +0: Variable Mark / Fixed Space Structure Mismatch (Marks Fixed: ", !marksAreVariable, ", Spaces Fixed: ", spacesAreFixed, ") in Segment ", segmentCount, ".\n");
-                    } else Debug(DEBUG_BRAND, "    +0: Not enough data pairs in Segment ", segmentCount, " to score structure.\n");
-                } else Debug(DEBUG_BRAND, "    +0: No data pairs in Segment ", segmentCount, ".\n");
-                currentSegmentStartPairIndex = i + 1;
-            }
+        if (view.dataCount <= 0) {
+            Debug(DEBUG_BRAND, "    +0: No data pairs in Segment ", segmentNumber, ".\n");
+            continue;
         }
+        int expectedDataPairs = isInitialFrame ? protocol.dataBits : protocol.repeatDataPairs;
+        int pairCountTolerance = expectedDataPairs < 2 ? expectedDataPairs : 2;
+        if (this->isWithinTolerance(view.dataCount, expectedDataPairs, pairCountTolerance)) {
+            score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", view.dataCount, ") close to expected (", expectedDataPairs, ") in Segment ", segmentNumber, ".\n");
+        } else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", view.dataCount, ") not close to expected (", expectedDataPairs, ") in Segment ", segmentNumber, ".\n");
+
+        if (!frameCarriesData) continue;
+        if (view.dataCount > 1) {
+            bool structureMatch = (protocol.encoding == IR_PULSE_WIDTH) ? (!view.marksFixed && view.spacesFixed)
+                                                                        : (view.marksFixed && !view.spacesFixed);
+            if (structureMatch) {
+                score++; Debug(DEBUG_BRAND, "    +1: Bit Structure Match in Segment ", segmentNumber, ".\n");
+            } else Debug(DEBUG_BRAND, "    +0: Bit Structure Mismatch (Marks Fixed: ", view.marksFixed, ", Spaces Fixed: ", view.spacesFixed, ") in Segment ", segmentNumber, ".\n");
+        } else Debug(DEBUG_BRAND, "    +0: Not enough data pairs in Segment ", segmentNumber, " to score structure.\n");
     }
-    Debug(DEBUG_BRAND, "SONY SIRC-12 Final Score: ", score, "\n");
+    Debug(DEBUG_BRAND, protocol.name, " Final Score: ", score, "\n");
+    Trace(IR_TRACE_SCORE, protocol.brand, score, 0);
     return score;
 }
 
-int IRReceiver::scoreJVC(const PulseSpacePair pairs[], int count) const {
+// Highest score scoreProtocol() can give count frames of this pass: preamble, pair count and
+// bit structure points, for the frame types that have them.
+int IRReceiver::maxProtocolScore(const IrProtocol& protocol, int count) const {
     int score = 0;
-    Debug(DEBUG_BRAND, "\nScoring for JVC...\n");
-    if (count == 0) return 0;
-    int currentSegmentStartPairIndex = 0;
-    int segmentCount = 0;
-
-    for (int i = 0; i < count; ++i) {
-        bool isSegmentEnd = false;
-        if ((pairs[i].space != -1 && this->isWithinTolerance(pairs[i].space, JVC_REPEAT_DELAY, 5000)) || i == count - 1) {
-             isSegmentEnd = true;
-        }
-        if (isSegmentEnd) {
-            int segmentEndPairIndex = i;
-            int segmentPairCount = segmentEndPairIndex - currentSegmentStartPairIndex + 1;
-            if (segmentPairCount > 0) {
-                segmentCount++;
-                Debug(DEBUG_BRAND, "  Detected JVC Segment ", segmentCount, " (Pairs: ", segmentPairCount, ")\n");
-                int segmentDataPairsStartIndex = currentSegmentStartPairIndex;
-                bool isInitialFrame = (segmentCount == 1);
-
-                if (isInitialFrame && segmentPairCount > 0 && pairs[currentSegmentStartPairIndex].pulse != -1 && pairs[currentSegmentStartPairIndex].space != -1) {
-                     RemoteBrand preambleMatch = this->matchPreamble(pairs[currentSegmentStartPairIndex].pulse, pairs[currentSegmentStartPairIndex].space, false);
-                     if (preambleMatch == JVC) { score++; Debug(DEBUG_BRAND, "    +1: Initial JVC Preamble Match in Segment 1.\n"); segmentDataPairsStartIndex = currentSegmentStartPairIndex + 1; }
-                     else Debug(DEBUG_BRAND, "    +0: Initial JVC Preamble Mismatch in Segment 1.\n");
-                } else if (!isInitialFrame) {
-                     int expectedRepeatPairCount = JVC_INITIAL_BITS; 
-                     int actualRepeatPairCount = segmentEndPairIndex - currentSegmentStartPairIndex + 1;
-                     if (this->isWithinTolerance(actualRepeatPairCount, expectedRepeatPairCount, 2)) { score++; Debug(DEBUG_BRAND, "    +1: JVC Repeat Frame Pair Count (", actualRepeatPairCount, ") close to expected (", expectedRepeatPairCount, ") in Segment ", segmentCount, ".\n"); }
-                     else Debug(DEBUG_BRAND, "    +0: JVC Repeat Frame Pair Count (", actualRepeatPairCount, ") not close to expected (", expectedRepeatPairCount, ") in Segment ", segmentCount, ".\n");
-                } else Debug(DEBUG_BRAND, "    +0: Segment 1 does not start with a valid pulse/space pair for preamble check.\n");
-
-                if (isInitialFrame) {
-                    int expectedDataPairCount = JVC_INITIAL_BITS - 1; 
-                    int actualDataPairCountInSegment = segmentEndPairIndex - segmentDataPairsStartIndex + 1;
-                    if (this->isWithinTolerance(actualDataPairCountInSegment, expectedDataPairCount, 2)) { score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", actualDataPairCountInSegment, ") close to expected JVC initial frame data length (", expectedDataPairCount, ") in Segment 1.\n"); }
-                    else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", actualDataPairCountInSegment, ") not close to expected JVC initial frame data length (", expectedDataPairCount, ") in Segment 1.\n");
-                }
-
-                 if (segmentPairCount > 1) {
-                     bool marksAreFixed = true; bool spacesAreVariable = false;
-                     int bitStructureCheckStartIndex = isInitialFrame ? segmentDataPairsStartIndex : currentSegmentStartPairIndex;
-                     int firstDataMark = pairs[bitStructureCheckStartIndex].pulse;
-                     for (int j = bitStructureCheckStartIndex; j <= segmentEndPairIndex; ++j) {
-                         if (pairs[j].pulse == -1) continue;
-                         if (!this->isWithinTolerance(pairs[j].pulse, firstDataMark, TIMING_TOLERANCE)) { marksAreFixed = false; break; }
-                     }
-                     int firstValidDataSpace = -1; int spacesCheckStartIndex = isInitialFrame ? segmentDataPairsStartIndex : currentSegmentStartPairIndex;
-                     for(int j = spacesCheckStartIndex; j <= segmentEndPairIndex; ++j) {
-                         if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, JVC_REPEAT_DELAY, 5000)) { firstValidDataSpace = pairs[j].space; break; }
-                     }
-                     bool allSpacesFixed = true;
-                     if (firstValidDataSpace != -1) {
-                         for (int j = spacesCheckStartIndex; j <= segmentEndPairIndex; ++j) {
-                             if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, JVC_REPEAT_DELAY, 5000)) {
-                                 if (!this->isWithinTolerance(pairs[j].space, firstValidDataSpace, TIMING_TOLERANCE)) { allSpacesFixed = false; break; }
-                             }
-                         }
-                     } else allSpacesFixed = false;
-                     if (!allSpacesFixed) spacesAreVariable = true;
-
-                     if (marksAreFixed && spacesAreVariable) { score++; Debug(DEBUG_BRAND, "    +1: Fixed Mark / Variable Space Structure Match in Segment ", segmentCount, ".\n"); }
-                     else Debug(DEBUG_BRAND, "    +0: Fixed Mark / Variable Space Structure Mismatch (Marks Fixed: ", marksAreFixed, ", Spaces Fixed: ", !spacesAreVariable, ") in Segment ", segmentCount, ".\n");
-                 } else if (segmentPairCount <= 1) Debug(DEBUG_BRAND, "    +0: Not enough data pairs in Segment ", segmentCount, " to score structure.\n");
-                currentSegmentStartPairIndex = i + 1;
-            }
+    for (int s = 0; s < count; ++s) {
+        if (m_burstFrameCount + s == 0) {
+            score += 3;
+        } else {
+            score += 1 + (protocol.repeatFrame != IR_REPEAT_NO_PREAMBLE ? 1 : 0) + (protocol.repeatFrame != IR_REPEAT_DITTO ? 1 : 0);
         }
     }
-    Debug(DEBUG_BRAND, "JVC Final Score: ", score, "\n");
     return score;
 }
 
-int IRReceiver::scoreNEC(const PulseSpacePair pairs[], int count) const {
-    int score = 0;
-    Debug(DEBUG_BRAND, "\nScoring for NEC...\n"); 
-    if (count == 0) return 0;
-    int currentSegmentStartPairIndex = 0;
-    int segmentCount = 0;
+// Decodes the data pairs of one frame with the protocol's bit encoding.
+IRReceiver::DecodedFrameInternal IRReceiver::decodeSegment(const IrProtocol& protocol, int firstPair, int dataPairCount) const {
+    DecodedFrameInternal result;
+    if (dataPairCount == 0) {
+        Debug(DEBUG_DECODE_SUMMARY, "  Cannot decode segment: no data pairs.\n");
+        return result;
+    }
+    uint32_t rawBits = 0;
+    int bitCount = 0;
+    bool pulseWidthCoded = (protocol.encoding == IR_PULSE_WIDTH);
 
-    for (int i = 0; i < count; ++i) {
-        bool isSegmentEnd = false;
-        if ((pairs[i].space != -1 && this->isWithinTolerance(pairs[i].space, NEC_REPEAT_DELAY, 5000)) || i == count - 1) {
-             isSegmentEnd = true;
-        }
-        if (isSegmentEnd) {
-            int segmentEndPairIndex = i;
-            int segmentPairCount = segmentEndPairIndex - currentSegmentStartPairIndex + 1;
-            if (segmentPairCount > 0) {
-                segmentCount++;
-                Debug(DEBUG_BRAND, "  Detected NEC Segment ", segmentCount, " (Pairs: ", segmentPairCount, ")\n");
-                int segmentDataPairsStartIndex = currentSegmentStartPairIndex;
-                bool isInitialFrame = (segmentCount == 1);
-
-                if (segmentPairCount > 0 && pairs[currentSegmentStartPairIndex].pulse != -1 && pairs[currentSegmentStartPairIndex].space != -1) {
-                    RemoteBrand preambleMatch = this->matchPreamble(pairs[currentSegmentStartPairIndex].pulse, pairs[currentSegmentStartPairIndex].space, !isInitialFrame);
-                    if (isInitialFrame && preambleMatch == NEC) { score++; Debug(DEBUG_BRAND, "    +1: Initial NEC Preamble Match in Segment 1.\n"); segmentDataPairsStartIndex = currentSegmentStartPairIndex + 1; }
-                    else if (!isInitialFrame && preambleMatch == NEC) { score++; Debug(DEBUG_BRAND, "    +1: Repeat NEC Preamble Match in Segment ", segmentCount, ".\n"); segmentDataPairsStartIndex = currentSegmentStartPairIndex + 1; }
-                    else if (isInitialFrame) Debug(DEBUG_BRAND, "    +0: Initial NEC Preamble Mismatch in Segment 1.\n");
-                    else Debug(DEBUG_BRAND, "    +0: Repeat NEC Preamble Mismatch in Segment ", segmentCount, ".\n");
-                } else Debug(DEBUG_BRAND, "    +0: Segment ", segmentCount, " does not start with a valid pulse/space pair for preamble check.\n");
-
-                int dataPairCountInSegment = segmentEndPairIndex - segmentDataPairsStartIndex + 1;
-                if (dataPairCountInSegment > 0 || (!isInitialFrame && dataPairCountInSegment == NEC_REPEAT_BITS)) { 
-                    if (isInitialFrame) {
-                        if (this->isWithinTolerance(dataPairCountInSegment, NEC_INITIAL_BITS -1, 2)) { 
-                            score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", dataPairCountInSegment, ") close to expected NEC initial frame data length (", NEC_INITIAL_BITS -1, ") in Segment 1.\n");
-                        } else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", dataPairCountInSegment, ") not close to expected NEC initial frame data length (", NEC_INITIAL_BITS -1, ") in Segment 1.\n");
-                    } else {
-                         if (this->isWithinTolerance(dataPairCountInSegment, NEC_REPEAT_BITS, 1)) {
-                            score++; Debug(DEBUG_BRAND, "    +1: Data Pair Count (", dataPairCountInSegment, ") close to expected NEC repeat frame data length (", NEC_REPEAT_BITS, ") in Segment ", segmentCount, ".\n");
-                         } else Debug(DEBUG_BRAND, "    +0: Data Pair Count (", dataPairCountInSegment, ") not close to expected NEC repeat frame data length (", NEC_REPEAT_BITS, ") in Segment ", segmentCount, ".\n");
-                    }
+    Debug(DEBUG_BITS, "  Attempting to decode data segment for brand: ", protocol.name, ". Segment has ", dataPairCount, " pulse/space pairs.\n");
 
-                    if (dataPairCountInSegment > 1 && isInitialFrame) {
-                         bool marksAreFixed = true; bool spacesAreVariable = false;
-                         int firstDataMark = pairs[segmentDataPairsStartIndex].pulse;
-                         Debug(DEBUG_BRAND, "    Checking bit structure for Segment ", segmentCount, " (Data Pairs: ", dataPairCountInSegment, ")\n");
-                         Debug(DEBUG_BRAND, "      First Data Mark: ", firstDataMark, " us\n");
-                         for (int j = segmentDataPairsStartIndex; j <= segmentEndPairIndex; ++j) {
-                             if (pairs[j].pulse == -1) { Debug(DEBUG_BRAND, "      Skipping Pair ", j, ": Missing pulse\n"); continue; }
-                             Debug(DEBUG_BRAND, "      Checking Pair ", j, ": Pulse=", pairs[j].pulse, " us, Space=", (pairs[j].space == -1 ? "MISSING" : String(pairs[j].space).c_str()), " us\n");
-                             if (!this->isWithinTolerance(pairs[j].pulse, firstDataMark, TIMING_TOLERANCE)) { marksAreFixed = false; Debug(DEBUG_BRAND, "      Mark at Pair ", j, " (", pairs[j].pulse, " us) is not fixed.\n"); break; }
-                             else Debug(DEBUG_BRAND, "      Mark at Pair ", j, " (", pairs[j].pulse, " us) is fixed.\n");
-                         }
-                         if (!marksAreFixed) Debug(DEBUG_BRAND, "      Marks are NOT fixed.\n"); else Debug(DEBUG_BRAND, "      Marks ARE fixed.\n");
-                         if (marksAreFixed) spacesAreVariable = true; 
-
-                         int firstValidDataSpace = -1;
-                         Debug(DEBUG_BRAND, "      Finding first valid data space...\n");
-                         for(int j = segmentDataPairsStartIndex; j <= segmentEndPairIndex; ++j) {
-                             if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, NEC_REPEAT_DELAY, 5000)) { firstValidDataSpace = pairs[j].space; Debug(DEBUG_BRAND, "      First valid data space found at Pair ", j, ": ", firstValidDataSpace, " us\n"); break; }
-                             Debug(DEBUG_BRAND, "      Pair ", j, " space (", (pairs[j].space == -1 ? "MISSING" : String(pairs[j].space).c_str()), " us) is repeat delay or missing.\n");
-                         }
-                         bool allSpacesFixed = true;
-                         if (firstValidDataSpace != -1) {
-                             Debug(DEBUG_BRAND, "      Checking if all spaces are fixed...\n");
-                             for (int j = segmentDataPairsStartIndex; j <= segmentEndPairIndex; ++j) {
-                                 if (pairs[j].space != -1 && !this->isWithinTolerance(pairs[j].space, NEC_REPEAT_DELAY, 5000)) {
-                                     Debug(DEBUG_BRAND, "      Checking Pair ", j, " space: ", pairs[j].space, " us\n");
-                                     if (!this->isWithinTolerance(pairs[j].space, firstValidDataSpace, TIMING_TOLERANCE)) { allSpacesFixed = false; Debug(DEBUG_BRAND, "      Space at Pair ", j, " (", pairs[j].space, " us) is not fixed.\n"); break; }
-                                     else Debug(DEBUG_BRAND, "      Space at Pair ", j, " (", pairs[j].space, " us) is fixed.\n");
-                                 } else if (pairs[j].space != -1 && this->isWithinTolerance(pairs[j].space, NEC_REPEAT_DELAY, 5000) && j != segmentEndPairIndex) {
-                                     allSpacesFixed = false; Debug(DEBUG_BRAND, "      Found repeat gap within data segment at Pair ", j, ".\n"); break;
-                                 } else Debug(DEBUG_BRAND, "      Pair ", j, " space (", (pairs[j].space == -1 ? "MISSING" : String(pairs[j].space).c_str()), " us) is repeat delay or missing.\n");
-                             }
-                         } else { allSpacesFixed = false; Debug(DEBUG_BRAND, "      No valid data spaces found to check for fixed timing.\n"); }
-                         if (!allSpacesFixed) spacesAreVariable = true; 
-
-                         Debug(DEBUG_BRAND, "      Marks Fixed: ", marksAreFixed, ", Spaces Variable: ", spacesAreVariable, "\n");
-                         if (marksAreFixed && spacesAreVariable) { score++; Debug(DEBUG_BRAND, "    +1: Fixed Mark / Variable Space Structure Match in Segment ", segmentCount, ".\n"); }
-                         else Debug(DEBUG_BRAND, "    +0: Fixed Mark / Variable Space Structure Mismatch (Marks Fixed: ", marksAreFixed, ", Spaces Fixed: ", !spacesAreVariable, ") in Segment ", segmentCount, ".\n");
-                     } else if (dataPairCountInSegment <= 1 && isInitialFrame) Debug(DEBUG_BRAND, "    +0: Not enough data pairs in Segment ", segmentCount, " to score structure.\n");
-                }
-                currentSegmentStartPairIndex = i + 1;
-            }
-        }
+    for (int i = 0; i < dataPairCount && bitCount < protocol.dataBits; ++i) {
+        int index = firstPair + i;
+        PulseSpacePair pair = this->_pair(index);
+        int pulse = pair.pulse; int space = pair.space;
+        bool inferredZero = (!pulseWidthCoded && i == dataPairCount - 1 && space == -1);
+        if (inferredZero) { space = protocol.zeroTiming.nominal(); Debug(DEBUG_BITS, "    Inferred last space as ZERO.\n");}
+        Debug(DEBUG_BITS, "    Pair ", i, " (Bit ", bitCount, "): Pulse: ", pulse, " us, Space: ", space, " us -> ");
+
+        int varying = pulseWidthCoded ? pulse : space;
+        if (varying == -1) { Debug(DEBUG_BITS, "MISSING TIMING\n"); break; }
+        if (!pulseWidthCoded && !this->_pairMatches(index, false, protocol, IR_SLOT_FIXED)) { Debug(DEBUG_BITS, "UNKNOWN PULSE\n"); Trace(IR_TRACE_BIT_ERROR, protocol.brand, bitCount, pulse); break; }
+
+        if (inferredZero || this->_pairMatches(index, !pulseWidthCoded, protocol, IR_SLOT_ZERO)) { Debug(DEBUG_BITS, "0\n"); bitCount++; }
+        else if (this->_pairMatches(index, !pulseWidthCoded, protocol, IR_SLOT_ONE)) { rawBits |= (1UL << bitCount); Debug(DEBUG_BITS, "1\n"); bitCount++; }
+        else { Debug(DEBUG_BITS, "UNKNOWN Timing\n"); Trace(IR_TRACE_BIT_ERROR, protocol.brand, bitCount, varying); break; }
     }
-    return score; 
+    return this->fieldsFromBits(protocol, rawBits, bitCount);
 }
 
-// This is the original decodeWinningSegment. It doesn't handle NEC checksums.
-// If NEC checksums are important and were part of the original .ino's DecodedIR struct,
-// this will need adjustment or a separate path for NEC.
-DecodedIR IRReceiver::decodeWinningSegment(RemoteBrand brand, const PulseSpacePair dataPairs[], int dataPairCount) const {
-    DecodedIR decodedData; // This struct does NOT have checksumValid as per your latest .h
-    if (brand == UNKNOWN || dataPairCount == 0) {
-        Debug(DEBUG_DECODE_SUMMARY, "  Cannot decode segment: Unknown brand or no data pairs.\n");
-        return decodedData;
+// Extracts address/command (bits are LSB first) following the descriptor's field layout and
+// validates the inverted command byte when the protocol has one.
+IRReceiver::DecodedFrameInternal IRReceiver::fieldsFromBits(const IrProtocol& protocol, uint32_t rawBits, int bitCount) const {
+    DecodedFrameInternal result;
+    result.base.brand = protocol.brand;
+
+    if (bitCount >= protocol.addressShift + protocol.addressBits) {
+        uint32_t address = (rawBits >> protocol.addressShift) & ((1UL << protocol.addressBits) - 1);
+        if ((protocol.fieldFlags & IR_FIELD_ADDRESS_INVERTED) && (uint8_t)((address & 0xFF) + (address >> 8)) == 0xFF) {
+            address &= 0xFF; // Standard 8-bit address followed by its complement
+        }
+        result.base.address = address;
     }
-    decodedData.brand = brand;
-    uint32_t rawBits = 0;
-    int bitCount = 0;
-    int maxBitsToDecode = 32;
-
-    Debug(DEBUG_BITS, "  Attempting to decode data segment for brand: ", brandToString(brand), ". Segment has ", dataPairCount, " pulse/space pairs.\n");
-
-    if (brand == SONY) {
-        maxBitsToDecode = SONY_INITIAL_BITS - 1;
-        for (int i = 0; i < dataPairCount && bitCount < maxBitsToDecode; ++i) {
-            int pulse = dataPairs[i].pulse; int space = dataPairs[i].space;
-            Debug(DEBUG_BITS, "    Pair ", i, " (Bit ", bitCount, "): Pulse: ", pulse, " us, Space: ", (space == -1 ? "MISSING" : String(space).c_str()), " us -> ");
-            if (pulse != -1) {
-                if (this->isWithinTolerance(pulse, SONY_ZERO_PULSE, TIMING_TOLERANCE)) { rawBits |= (0UL << bitCount); Debug(DEBUG_BITS, "0\n"); bitCount++; }
-                else if (this->isWithinTolerance(pulse, SONY_ONE_PULSE, TIMING_TOLERANCE)) { rawBits |= (1UL << bitCount); Debug(DEBUG_BITS, "1\n"); bitCount++; }
-                else { Debug(DEBUG_BITS, "UNKNOWN PULSE Timing\n"); break; }
-            } else { Debug(DEBUG_BITS, "MISSING PULSE\n"); break; }
-            if (bitCount == maxBitsToDecode && space != -1 && this->isWithinTolerance(space, SONY_REPEAT_DELAY, 5000)) { Debug(DEBUG_BITS, "    Detected SONY repeat delay after decoding last bit.\n"); break; }
-            if (bitCount == maxBitsToDecode && space != -1 && this->isWithinTolerance(space, SONY_BIT_SPACE, TIMING_TOLERANCE)) { Debug(DEBUG_BITS, "    Decoded all expected SONY data bits.\n"); break; }
-        }
-        if (bitCount >= 7) decodedData.command = (rawBits >> 0) & 0x7F;
-        if (bitCount >= 12) decodedData.address = (rawBits >> 7) & 0x1F;
-        Debug(DEBUG_DECODE_SUMMARY, "  Decoded SONY (", bitCount, " bits) - Command: ", decodedData.command, ", Address: ", decodedData.address, "\n");
-
-    } else if (brand == JVC) { // Separated JVC from NEC for clarity as NEC was more complex
-        const int expectedPulse = JVC_BIT_PULSE;
-        const int zeroSpace = JVC_ZERO_SPACE;
-        const int oneSpace = JVC_ONE_SPACE;
-        maxBitsToDecode = 16; // 8 Addr + 8 Cmd for JVC
-
-        for (int i = 0; i < dataPairCount && bitCount < maxBitsToDecode; ++i) {
-            int pulse = dataPairs[i].pulse; int space = dataPairs[i].space;
-            if (i == dataPairCount - 1 && space == -1) { space = zeroSpace; Debug(DEBUG_BITS, "    Inferred last JVC space as ZERO.\n");}
-            Debug(DEBUG_BITS, "    Pair ", i, " (Bit ", bitCount, "): Pulse: ", pulse, " us, Space: ", (space == -1 ? "MISSING" : String(space).c_str()), " us -> ");
-            if (this->isWithinTolerance(pulse, expectedPulse, TIMING_TOLERANCE)) {
-                 if (space != -1) {
-                      if (this->isWithinTolerance(space, zeroSpace, TIMING_TOLERANCE)) { rawBits |= (0UL << bitCount); Debug(DEBUG_BITS, "0\n"); bitCount++; }
-                      else if (this->isWithinTolerance(space, oneSpace, TIMING_TOLERANCE)) { rawBits |= (1UL << bitCount); Debug(DEBUG_BITS, "1\n"); bitCount++; }
-                      else { Debug(DEBUG_BITS, "UNKNOWN SPACE Timing\n"); break; }
-                 } else { Debug(DEBUG_BITS, "MISSING SPACE (Not Last Bit)\n"); break; }
-            } else { Debug(DEBUG_BITS, "UNKNOWN PULSE\n"); break; }
-        }
-        if (bitCount >= 8) decodedData.address = (rawBits >> 0) & 0xFF;
-        if (bitCount >= 16) decodedData.command = (rawBits >> 8) & 0xFF;
-        Debug(DEBUG_DECODE_SUMMARY, "  Decoded JVC (", bitCount, " bits) - Address: ", decodedData.address, ", Command: ", decodedData.command, "\n");
-    }
-    // NEC decoding is handled by decodeNECData now
-    return decodedData;
-}
-
-// Specific decoder for NEC to handle checksum, returning it via DecodedNECInternal
-IRReceiver::DecodedNECInternal IRReceiver::decodeNECData(const PulseSpacePair dataPairs[], int dataPairCount) const {
-    DecodedNECInternal result;
-    result.base.brand = NEC; // Set brand for the base part
-    uint32_t rawBits = 0;
-    int bitCount = 0;
-    int maxBitsToDecode = NEC_INITIAL_BITS - 1; // 32 data bits for NEC
-
-    Debug(DEBUG_BITS, "  Attempting to decode NEC data. Segment has ", dataPairCount, " pulse/space pairs.\n");
-
-    const int expectedPulse = NEC_BIT_PULSE;
-    const int zeroSpace = NEC_ZERO_SPACE;
-    const int oneSpace = NEC_ONE_SPACE;
-
-    for (int i = 0; i < dataPairCount && bitCount < maxBitsToDecode; ++i) {
-        int pulse = dataPairs[i].pulse; int space = dataPairs[i].space;
-        if (i == dataPairCount - 1 && space == -1) { space = zeroSpace; Debug(DEBUG_BITS, "    Inferred last NEC space as ZERO.\n");}
-        Debug(DEBUG_BITS, "    Pair ", i, " (Bit ", bitCount, "): Pulse: ", pulse, " us, Space: ", (space == -1 ? "MISSING" : String(space).c_str()), " us -> ");
-        if (this->isWithinTolerance(pulse, expectedPulse, TIMING_TOLERANCE)) {
-             if (space != -1) {
-                  if (this->isWithinTolerance(space, zeroSpace, TIMING_TOLERANCE)) { rawBits |= (0UL << bitCount); Debug(DEBUG_BITS, "0\n"); bitCount++; }
-                  else if (this->isWithinTolerance(space, oneSpace, TIMING_TOLERANCE)) { rawBits |= (1UL << bitCount); Debug(DEBUG_BITS, "1\n"); bitCount++; }
-                  else { Debug(DEBUG_BITS, "UNKNOWN SPACE Timing\n"); break; }
-             } else { Debug(DEBUG_BITS, "MISSING SPACE (Not Last Bit)\n"); break; }
-        } else { Debug(DEBUG_BITS, "UNKNOWN PULSE\n"); break; }
-    }
-
-    int addressByte1 = (bitCount >= 8) ? (rawBits >> 0) & 0xFF : -1;
-    int addressByte2 = (bitCount >= 16) ? (rawBits >> 8) & 0xFF : -1;
-    int commandByte1 = (bitCount >= 24) ? (rawBits >> 16) & 0xFF : -1;
-    int commandByte2 = (bitCount >= 32) ? (rawBits >> 24) & 0xFF : -1;
-
-    if (addressByte1 != -1 && addressByte2 != -1 && (uint8_t)(addressByte1 + addressByte2) == 0xFF) { 
-        result.base.address = addressByte1; 
-        Debug(DEBUG_DECODE_SUMMARY, "  NEC Address: 8-bit (", result.base.address, ")\n"); 
-    } else if (addressByte1 != -1 && addressByte2 != -1) { // Extended NEC or non-standard
-        result.base.address = (addressByte2 << 8) | addressByte1; 
-        Debug(DEBUG_DECODE_SUMMARY, "  NEC Address: 16-bit (", result.base.address, ")\n"); 
-    } else if (addressByte1 != -1) { // Only one address byte decoded
-        result.base.address = addressByte1; 
-        Debug(DEBUG_DECODE_SUMMARY, "  NEC Address: 8-bit (partial decode: ", result.base.address, ")\n"); 
-    } else {
-        Debug(DEBUG_DECODE_SUMMARY, "  NEC Address: UNKNOWN (not enough bits)\n");
-    }
-
-    if (commandByte1 != -1) {
-         result.base.command = commandByte1; 
-         Debug(DEBUG_DECODE_SUMMARY, "  NEC Command: ", result.base.command, "\n");
-         if (commandByte2 != -1) {
-              if ((uint8_t)(commandByte1 + commandByte2) == 0xFF) { 
-                  result.checksumValid = true; 
-                  Debug(DEBUG_DECODE_SUMMARY, "  NEC Command Checksum Valid.\n"); 
-              } else {
-                   Debug(DEBUG_DECODE_SUMMARY, "  NEC Command Checksum Invalid (", commandByte1, " + ", commandByte2, " != 255).\n");
-              }
-         } else {
-             Debug(DEBUG_DECODE_SUMMARY, "  NEC Command Checksum: Not enough bits for validation.\n");
-         }
-    } else {
-         Debug(DEBUG_DECODE_SUMMARY, "  NEC Command: UNKNOWN (not enough bits)\n");
+    if (bitCount >= protocol.commandShift + protocol.commandBits) {
+        result.base.command = (rawBits >> protocol.commandShift) & ((1UL << protocol.commandBits) - 1);
+        if ((protocol.fieldFlags & IR_FIELD_COMMAND_INVERTED) && bitCount >= protocol.commandShift + 2 * protocol.commandBits) {
+            uint8_t inverted = (rawBits >> (protocol.commandShift + protocol.commandBits)) & 0xFF;
+            result.checksumValid = ((uint8_t)(result.base.command + inverted) == 0xFF);
+        }
     }
-    Debug(DEBUG_DECODE_SUMMARY, "  Decoded NEC (", bitCount, " bits) - Address: ", result.base.address, ", Command: ", result.base.command, ", Checksum Valid: ", result.checksumValid ? "Yes" : "No", "\n");
+    Debug(DEBUG_DECODE_SUMMARY, "  Decoded ", protocol.name, " (", bitCount, " bits) - Address: ", result.base.address, ", Command: ", result.base.command);
+    if (protocol.fieldFlags & IR_FIELD_COMMAND_INVERTED) Debug(DEBUG_DECODE_SUMMARY, ", Checksum Valid: ", result.checksumValid ? "Yes" : "No");
+    Debug(DEBUG_DECODE_SUMMARY, "\n");
+    Trace(IR_TRACE_FRAME, protocol.brand, result.base.command, result.base.address);
     return result;
 }
 
 
-void IRReceiver::determineWinner(const DecodedIR segments[], int count, const bool segmentChecksums[]) {
+void IRReceiver::determineWinner(RemoteBrand brand, const FrameVote votes[], int count) {
     this->m_finalResultCode = DecodedIR(); 
 
     if (count == 0) {
         Debug(DEBUG_DECODE_SUMMARY, "\n--- No Decoded Segments for Winner Determination ---\n");
         return;
     }
-    Debug(DEBUG_DECODE_SUMMARY, "\nDecoded Segments:\n");
+    Debug(DEBUG_DECODE_SUMMARY, "\nDecoded Codes:\n");
     for(int i = 0; i < count; ++i) {
-        Debug(DEBUG_DECODE_SUMMARY, "  Segment ", i + 1, ": Brand=", brandToString(segments[i].brand), ", Command=", segments[i].command, ", Address=", segments[i].address);
-        if (segments[i].brand == NEC) Debug(DEBUG_DECODE_SUMMARY, ", Checksum Valid=", segmentChecksums[i] ? "Yes" : "No");
-        Debug(DEBUG_DECODE_SUMMARY, "\n");
-    }
-
-    struct DecodedCount { DecodedIR data; int count = 0; bool checksumValidForNEC = false; }; // Add checksum for NEC uniqueness
-    DecodedCount counts[IR_LIB_MAX_DECODED_SEGMENTS]; 
-    int uniqueCount = 0;
-
-    for(int i = 0; i < count; ++i) {
-        bool found = false;
-        if (segments[i].brand != UNKNOWN && segments[i].command != -1) { // Only process valid decodes
-            for(int j = 0; j < uniqueCount; ++j) {
-                bool match = (segments[i].brand == counts[j].data.brand &&
-                              segments[i].command == counts[j].data.command &&
-                              segments[i].address == counts[j].data.address );
-                if (segments[i].brand == NEC) {
-                    match &= (segmentChecksums[i] == counts[j].checksumValidForNEC);
-                }
-                // Other brands don't use checksum for this comparison
-                
-                if (match) {
-                    counts[j].count++;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found && uniqueCount < IR_LIB_MAX_DECODED_SEGMENTS) {
-                counts[uniqueCount].data = segments[i];
-                counts[uniqueCount].count = 1;
-                if(segments[i].brand == NEC) {
-                    counts[uniqueCount].checksumValidForNEC = segmentChecksums[i];
-                }
-                uniqueCount++;
-            }
-        }
+        Debug(DEBUG_DECODE_SUMMARY, "  Code ", i + 1, ": Brand=", brandToString(brand), ", Command=", votes[i].command, ", Address=", votes[i].address);
+        Debug(DEBUG_DECODE_SUMMARY, ", Checksum Valid=", votes[i].checksumValid ? "Yes" : "No");
+        Debug(DEBUG_DECODE_SUMMARY, ", Occurrences=", votes[i].count, "\n");
     }
 
     int maxCount = 0; int winnerIndex = -1;
-    for(int i = 0; i < uniqueCount; ++i) {
-        if (counts[i].count > maxCount) {
-            maxCount = counts[i].count;
+    for(int i = 0; i < count; ++i) { // Ties go to the code seen first
+        if (votes[i].count > maxCount) {
+            maxCount = votes[i].count;
             winnerIndex = i;
         }
     }
 
     if (winnerIndex != -1) {
-        this->m_finalResultCode = counts[winnerIndex].data;
-        // Note: m_finalResultCode (DecodedIR) does not store checksum.
-        // The example sketch would need to be aware if it wants to print this.
-        // For now, the library determines the winner based on it, but doesn't store it in the final public struct.
+        this->m_finalResultCode.brand = brand;
+        this->m_finalResultCode.command = votes[winnerIndex].command;
+        this->m_finalResultCode.address = votes[winnerIndex].address;
+        this->m_finalResultCode.checksumValid = votes[winnerIndex].checksumValid;
+        this->m_finalResultCode.repeatCount = votes[winnerIndex].count - 1;
         Debug(DEBUG_DECODE_SUMMARY, "\n--- Winning Decoded IR Signal ---\n");
+        Trace(IR_TRACE_CODE, brand, this->m_finalResultCode.command, this->m_finalResultCode.address);
         Debug(DEBUG_DECODE_SUMMARY, "Brand: ", brandToString(this->m_finalResultCode.brand), ", Command: ", this->m_finalResultCode.command, ", Address: ", this->m_finalResultCode.address);
-        if (this->m_finalResultCode.brand == NEC) Debug(DEBUG_DECODE_SUMMARY, ", (NEC Checksum for winning segment: ", counts[winnerIndex].checksumValidForNEC ? "Valid" : "Invalid", ")");
-        Debug(DEBUG_DECODE_SUMMARY, " (Occurrences: ", counts[winnerIndex].count, ")\n");
+        Debug(DEBUG_DECODE_SUMMARY, ", (Checksum for winning segment: ", votes[winnerIndex].checksumValid ? "Valid" : "Invalid", ")");
+        Debug(DEBUG_DECODE_SUMMARY, " (Occurrences: ", votes[winnerIndex].count, ")\n");
         Debug(DEBUG_DECODE_SUMMARY, "-----------------------------------\n");
     } else {
         Debug(DEBUG_DECODE_SUMMARY, "\n--- No Winning Decoded Signal Found ---\n");
@@ -852,73 +1891,257 @@ void IRReceiver::determineWinner(const DecodedIR segments[], int count, const bo
 }
 
 const char* IRReceiver::brandToString(RemoteBrand brand) const {
-    switch (brand) {
-        case JVC: return "JVC";
-        case SONY: return "SONY";
-        case NEC: return "NEC";
-        case UNKNOWN: default: return "UNKNOWN";
+    if (brand == LEARNED) return "LEARNED";
+    const IrProtocol* protocol = findProtocol(brand);
+    return protocol ? protocol->name : "UNKNOWN";
+}
+
+// Finds the button in the remote registered for (brand, address), falling back to the
+// brand's wildcard remote. The built-in wildcard remotes map SONY to the Sceptre codes.
+const IrButton* IRReceiver::_lookupButton(RemoteBrand brand, int address, int commandCode, bool& inFlash) const {
+    const IrRemote* remote = findRemote(brand, address);
+    if (remote == nullptr) {
+        return nullptr;
     }
+    inFlash = remote->inFlash;
+    return findButton(remote->buttons, remote->count, commandCode, remote->inFlash); // Tables are sorted by command code
 }
 
-const char* IRReceiver::getButtonName(RemoteBrand brand, int commandCode) const {
-    const IrButton* buttonArray = nullptr;
-    size_t buttonCount = 0;
-
-    // Select the correct button array based on the brand
-    // Your notes indicate Sceptre uses Sony protocol, so we map SONY brand to SCEPTRE_BUTTONS
-    switch (brand) {
-        case SONY: // Sceptre codes are used for SONY brand
-            buttonArray = SCEPTRE_BUTTONS;
-            buttonCount = SCEPTRE_BUTTONS_COUNT;
-            break;
-        case JVC:
-            buttonArray = JVC_BUTTONS;
-            buttonCount = JVC_BUTTONS_COUNT;
-            break;
-        case NEC:
-            buttonArray = NEC_BUTTONS;
-            buttonCount = NEC_BUTTONS_COUNT;
-            break;
-        case UNKNOWN:
-        default:
-            // For an unknown brand, we can't look up in a specific array.
-            // Fall through to the generic unknown command formatting.
-            break;
+// Appends text to buffer, truncating at bufferSize - 1 characters.
+static void appendText(char* buffer, size_t bufferSize, size_t& length, const char* text) {
+    while (*text != '\0' && length + 1 < bufferSize) {
+        buffer[length++] = *text++;
     }
+    buffer[length] = '\0';
+}
 
-    // Iterate through the selected array to find the command code
-    if (buttonArray != nullptr && buttonCount > 0) {
-        for (size_t i = 0; i < buttonCount; ++i) {
-            if (buttonArray[i].commandCode == commandCode) {
-                return buttonArray[i].name; // Found the button name
-            }
-        }
+// Writes the button name into the caller's buffer. Unknown codes are formatted as
+// "BRAND_CMD_DDD" or "CMD_DDD" (decimal). Uses no shared state, so any task may call it.
+// Returns the length written, at most bufferSize - 1.
+size_t IRReceiver::_formatButtonName(RemoteBrand brand, int address, int commandCode, char* buffer, size_t bufferSize) const {
+    if (buffer == nullptr || bufferSize == 0) {
+        return 0;
+    }
+    size_t length = 0;
+    buffer[0] = '\0';
+
+    bool inFlash = false;
+    const IrButton* button = _lookupButton(brand, address, commandCode, inFlash);
+    if (button != nullptr) {
+#if IR_BUTTONS_IN_PROGMEM
+        if (inFlash) strncpy_P(buffer, button->name, bufferSize - 1); // Names are in flash
+        else strncpy(buffer, button->name, bufferSize - 1);           // Loaded by loadRemotes()
+#else
+        strncpy(buffer, button->name, bufferSize - 1);
+#endif
+        buffer[bufferSize - 1] = '\0';
+        return strlen(buffer);
     }
 
-    // If code not found, format a string like "BRAND_CMD_DDD" or "CMD_DDD"
-    // using itoa and string functions.
-    static char unknownCmdBuf[32]; // Ensure buffer is large enough
-    char numBuf[15]; // Buffer for the number string (max 11 chars for int + null)
+    if (findProtocol(brand) != nullptr) { // Only enabled protocols get a "BRAND_" prefix
+        appendText(buffer, bufferSize, length, brandToString(brand));
+        appendText(buffer, bufferSize, length, "_");
+    }
+    appendText(buffer, bufferSize, length, "CMD_");
+
+    char digits[12]; // "-2147483648" plus terminator
+    char* cursor = digits + sizeof(digits) - 1;
+    *cursor = '\0';
+    unsigned long magnitude = (commandCode < 0) ? 0UL - (unsigned long)commandCode : (unsigned long)commandCode;
+    do {
+        *--cursor = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (commandCode < 0) *--cursor = '-';
+    appendText(buffer, bufferSize, length, cursor);
+    return length;
+}
 
-    itoa(commandCode, numBuf, 6); // Convert integer to string (base 10)
+// Convenience form returning a pointer. Names held in RAM are returned directly;
+// everything else goes through one shared buffer that the next call overwrites, so this
+// is not thread-safe. _formatButtonName() is the reentrant path.
+const char* IRReceiver::_buttonName(RemoteBrand brand, int address, int commandCode) const {
+    bool inFlash = false;
+    const IrButton* button = _lookupButton(brand, address, commandCode, inFlash);
+    if (button != nullptr && !(IR_BUTTONS_IN_PROGMEM && inFlash)) {
+        return button->name; // Found the button name
+    }
+    static char nameBuf[IR_LIB_BUTTON_TEXT_SIZE];
+    _formatButtonName(brand, address, commandCode, nameBuf, sizeof(nameBuf));
+    return nameBuf;
+}
 
-    switch (brand) {
-        case SONY:
-            strcpy(unknownCmdBuf, "SONY_CMD_");
-            break;
-        case JVC:
-            strcpy(unknownCmdBuf, "JVC_CMD_");
-            break;
-        case NEC:
-            strcpy(unknownCmdBuf, "NEC_CMD_");
-            break;
-        case UNKNOWN:
-        default:
-            strcpy(unknownCmdBuf, "CMD_");
-            break;
+// Brand-only lookups use the brand's wildcard remote.
+size_t IRReceiver::getButtonName(RemoteBrand brand, int commandCode, char* buffer, size_t bufferSize) const {
+    return _formatButtonName(brand, IR_ADDRESS_ANY, commandCode, buffer, bufferSize);
+}
+
+const char* IRReceiver::getButtonName(RemoteBrand brand, int commandCode) const {
+    return _buttonName(brand, IR_ADDRESS_ANY, commandCode);
+}
+
+// Code lookups prefer the remote registered for the decoded address.
+size_t IRReceiver::getButtonName(const DecodedIR& code, char* buffer, size_t bufferSize) const {
+    return _formatButtonName(code.brand, code.address, code.command, buffer, bufferSize);
+}
+
+const char* IRReceiver::getButtonName(const DecodedIR& code) const {
+    return _buttonName(code.brand, code.address, code.command);
+}
+
+// Returns the name of the remote that would label this code, or nullptr if none matches.
+const char* IRReceiver::getRemoteName(const DecodedIR& code) const {
+    const IrRemote* remote = findRemote(code.brand, code.address);
+    return remote ? remote->name : nullptr;
+}
+
+bool IRReceiver::addRemote(RemoteBrand brand, int address, const IrButton buttons[], size_t count,
+                           const char* name, bool inFlash) {
+    return registerRemote(brand, address, buttons, count, name, inFlash);
+}
+
+// --- Remote Definition Loading ---
+// A remote being read by loadRemotes(). The table and name are kept on the heap for as
+// long as the remote stays registered.
+struct RemoteDraft {
+    RemoteBrand brand;
+    int address;
+    char* name;
+    IrButton* buttons;
+    size_t count;
+    size_t capacity;
+};
+
+// Splits off the next whitespace separated token. Returns nullptr at the end of the line.
+static char* nextToken(char*& cursor) {
+    while (*cursor == ' ' || *cursor == '\t') cursor++;
+    if (*cursor == '\0') return nullptr;
+    char* token = cursor;
+    while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t') cursor++;
+    if (*cursor != '\0') *cursor++ = '\0';
+    return token;
+}
+
+// Parses a decimal or 0x hex number. Returns false for anything else.
+static bool parseNumber(const char* token, long& value) {
+    char* end = nullptr;
+    value = strtol(token, &end, 0);
+    return end != token && *end == '\0';
+}
+
+static bool brandFromName(const char* name, RemoteBrand& brand) {
+    if (strcasecmp(name, "LEARNED") == 0) {
+        brand = LEARNED;
+        return true;
     }
-    strcat(unknownCmdBuf, numBuf); // Append the number string
-    return unknownCmdBuf;
+    for (size_t i = 0; i < IR_PROTOCOLS_COUNT; i++) {
+        if (strcasecmp(name, IR_PROTOCOLS[i].name) == 0) {
+            brand = IR_PROTOCOLS[i].brand;
+            return true;
+        }
+    }
+    return false;
 }
 
+// Reads one line, dropping anything past IR_LIB_REMOTE_LINE_SIZE. Returns false at the end of input.
+static bool readLine(Stream& input, char* line, size_t lineSize) {
+    size_t length = 0;
+    bool any = false;
+    int c;
+    while ((c = input.read()) >= 0) {
+        any = true;
+        if (c == '\n') break;
+        if (c != '\r' && length + 1 < lineSize) line[length++] = (char)c;
+    }
+    line[length] = '\0';
+    return any;
+}
+
+// Sorts the draft table (insertion sort, names stay with their codes) and registers it.
+// For duplicate command codes the last definition wins.
+static bool finishDraft(RemoteDraft& draft) {
+    IrButton* buttons = draft.buttons;
+    size_t count = 0;
+    for (size_t i = 0; i < draft.count; i++) {
+        IrButton entry = buttons[i];
+        size_t pos = count;
+        while (pos > 0 && buttons[pos - 1].commandCode > entry.commandCode) pos--;
+        if (pos > 0 && buttons[pos - 1].commandCode == entry.commandCode) {
+            buttons[pos - 1] = entry;
+            continue;
+        }
+        memmove(&buttons[pos + 1], &buttons[pos], (count - pos) * sizeof(IrButton));
+        buttons[pos] = entry;
+        count++;
+    }
+    if (registerRemote(draft.brand, draft.address, buttons, count, draft.name, false)) {
+        return true;
+    }
+    Debug(DEBUG_GENERAL, "loadRemotes: registry full, dropped ", draft.name ? draft.name : "remote", "\n");
+    free(draft.buttons);
+    free(draft.name);
+    return false;
+}
 
+// Reads remote definitions, e.g. from a LittleFS file, until read() returns -1:
+//   # comment
+//   remote NEC 0x04 LivingRoomTV    (brand, address or *, optional name)
+//   0x45 power                      (command code, button name)
+// Returns the number of remotes registered. Call it at startup; tables are never freed.
+int IRReceiver::loadRemotes(Stream& input) {
+    char line[IR_LIB_REMOTE_LINE_SIZE];
+    RemoteDraft draft = {};
+    bool inRemote = false;
+    int loaded = 0;
+
+    while (readLine(input, line, sizeof(line))) {
+        char* comment = strchr(line, '#');
+        if (comment != nullptr) *comment = '\0';
+        char* cursor = line;
+        char* first = nextToken(cursor);
+        if (first == nullptr) continue;
+
+        if (strcmp(first, "remote") == 0) {
+            if (inRemote && finishDraft(draft)) loaded++;
+            inRemote = false;
+            char* brandName = nextToken(cursor);
+            char* addressText = nextToken(cursor);
+            char* name = nextToken(cursor);
+            long address = IR_ADDRESS_ANY;
+            RemoteBrand brand = UNKNOWN;
+            if (brandName == nullptr || addressText == nullptr || !brandFromName(brandName, brand) ||
+                (strcmp(addressText, "*") != 0 && (!parseNumber(addressText, address) || address < 0))) {
+                Debug(DEBUG_GENERAL, "loadRemotes: bad remote line\n");
+                continue; // Buttons up to the next remote line are skipped
+            }
+            draft = {};
+            draft.brand = brand;
+            draft.address = (int)address;
+            if (name != nullptr && (draft.name = (char*)malloc(strlen(name) + 1)) != nullptr) {
+                strcpy(draft.name, name);
+            }
+            inRemote = true;
+            continue;
+        }
+
+        long commandCode;
+        char* buttonName = nextToken(cursor);
+        if (!inRemote || buttonName == nullptr || !parseNumber(first, commandCode) || commandCode < 0 || commandCode > 0xFFFF) {
+            Debug(DEBUG_GENERAL, "loadRemotes: bad button line\n");
+            continue;
+        }
+        if (draft.count == draft.capacity) {
+            size_t capacity = draft.capacity ? draft.capacity * 2 : 8;
+            IrButton* grown = (IrButton*)realloc(draft.buttons, capacity * sizeof(IrButton));
+            if (grown == nullptr) continue; // Out of memory: keep what fits
+            draft.buttons = grown;
+            draft.capacity = capacity;
+        }
+        IrButton& button = draft.buttons[draft.count++];
+        button.commandCode = (uint16_t)commandCode;
+        strncpy(button.name, buttonName, sizeof(button.name) - 1);
+        button.name[sizeof(button.name) - 1] = '\0';
+    }
+    if (inRemote && finishDraft(draft)) loaded++;
+    return loaded;
+}
@@ -3,12 +3,155 @@
 
 #include <Arduino.h>
 #include "IRButtonDefs.h"
+#include "IRProtocolDefs.h"
 #include "IRReceiverDebug.h" 
 
+#ifndef IRAM_ATTR // Only ESP8266/ESP32 cores define it
+#define IRAM_ATTR
+#endif
+
+// The capture ISR reads the pin's input register directly wherever the core provides the
+// register macros, instead of going through digitalRead().
+#if defined(portInputRegister) && defined(digitalPinToPort) && defined(digitalPinToBitMask)
+#define IR_LIB_FAST_PIN_READ 1
+#if defined(__AVR__)
+typedef uint8_t ir_port_t;
+#else
+typedef uint32_t ir_port_t;
+#endif
+#else
+#define IR_LIB_FAST_PIN_READ 0
+#endif
+
+// FreeRTOS decode task: always available on ESP32. STM32 sketches using the STM32FreeRTOS
+// library opt in with -DIR_LIB_USE_FREERTOS=1.
+#if defined(ESP32)
+#define IR_LIB_HAS_FREERTOS 1
+#elif defined(ARDUINO_ARCH_STM32) && defined(IR_LIB_USE_FREERTOS) && IR_LIB_USE_FREERTOS
+#include <STM32FreeRTOS.h>
+#define IR_LIB_HAS_FREERTOS 1
+#else
+#define IR_LIB_HAS_FREERTOS 0
+#endif
+
 // --- Configuration Constants
-#define IR_LIB_MAX_TRANSITIONS 300
+#define IR_LIB_MAX_TRANSITIONS 300 // Capacity of the ISR ring buffer (one slot is always kept free)
 #define IR_LIB_IDLE_TIMEOUT_MS 100
-#define IR_LIB_MAX_DECODED_SEGMENTS 10
+#define IR_LIB_MAX_FRAME_VOTES 4 // Distinct codes tallied per protocol and burst for the majority vote
+#define IR_LIB_MAX_SEGMENTS 16 // Frames indexed per analysis pass; later frames wait for the next pass
+#ifndef IR_LIB_COMPACT_DURATIONS // 16-bit ring entries decoded in place, default on 2 KB AVRs
+#if defined(__AVR__)
+#define IR_LIB_COMPACT_DURATIONS 1
+#else
+#define IR_LIB_COMPACT_DURATIONS 0
+#endif
+#endif
+#ifndef IR_LIB_SYMBOL_STREAM // Quantize each pass once into byte symbols for the decoders (2 bytes per pair)
+#define IR_LIB_SYMBOL_STREAM 0
+#endif
+#if IR_LIB_SYMBOL_STREAM && IR_LIB_COMPACT_DURATIONS
+#error "IR_LIB_SYMBOL_STREAM needs IR_LIB_COMPACT_DURATIONS 0"
+#endif
+#ifndef IR_LIB_MIN_PULSE_US
+#define IR_LIB_MIN_PULSE_US 100 // Default for setGlitchFilter(); 0 compiles the capture filter out
+#endif
+#ifndef IR_LIB_EARLY_DISPATCH
+#define IR_LIB_EARLY_DISPATCH 1 // Score and decode only the expected protocol when its frames fit it perfectly
+#endif
+#ifndef IR_LIB_EARLY_COMMIT_FRAMES
+#define IR_LIB_EARLY_COMMIT_FRAMES 0 // Default for setEarlyCommit(); 0 publishes each code when its burst ends
+#endif
+#ifndef IR_LIB_EVENT_QUEUE_DEPTH
+#define IR_LIB_EVENT_QUEUE_DEPTH 4 // Decoded codes held until getCode(); the oldest is dropped when full
+#endif
+#ifndef IR_LIB_DECODE_TASK_STACK
+#if defined(ESP32)
+#define IR_LIB_DECODE_TASK_STACK 4096 // Bytes on ESP32
+#else
+#define IR_LIB_DECODE_TASK_STACK 512  // Words on vanilla FreeRTOS
+#endif
+#endif
+#ifndef IR_LIB_DECODE_TASK_CORE // Default core for startDecodeTask(), -1 for none
+#if defined(ESP32) && !CONFIG_FREERTOS_UNICORE
+#if defined(CONFIG_ARDUINO_RUNNING_CORE)
+#define IR_LIB_DECODE_TASK_CORE (CONFIG_ARDUINO_RUNNING_CORE == 0 ? 1 : 0) // The core loop() does not use
+#else
+#define IR_LIB_DECODE_TASK_CORE 0
+#endif
+#else
+#define IR_LIB_DECODE_TASK_CORE -1
+#endif
+#endif
+#ifndef IR_LIB_END_TIMER // One-shot timer that ends a burst as soon as it has been quiet for IR_LIB_IDLE_TIMEOUT_MS
+#if defined(ESP32)
+#define IR_LIB_END_TIMER 1
+#else
+#define IR_LIB_END_TIMER 0
+#endif
+#endif
+#if IR_LIB_END_TIMER
+#include <esp_timer.h>
+#endif
+#ifndef IR_LIB_BUTTON_TEXT_SIZE
+#define IR_LIB_BUTTON_TEXT_SIZE 32 // Enough for any button name or "BRAND_CMD_-2147483648"
+#endif
+#ifndef IR_LIB_REMOTE_LINE_SIZE
+#define IR_LIB_REMOTE_LINE_SIZE 48 // Longest line loadRemotes() reads; the rest is ignored
+#endif
+#ifndef IR_LIB_MAX_RECEIVERS
+#define IR_LIB_MAX_RECEIVERS 4 // Receivers that can be active at once (up to 8), one ISR trampoline each
+#endif
+#ifndef IR_LIB_LOW_POWER
+#define IR_LIB_LOW_POWER 0 // sleepUntilIR(); on AVR this defines the pin change interrupt vectors
+#endif
+#ifndef IR_LIB_WAKE_LATENCY_US // Time from the waking edge until code runs again
+#if defined(__AVR__)
+#define IR_LIB_WAKE_LATENCY_US (16384000000UL / F_CPU) // 16K clock crystal start-up
+#elif defined(ESP32)
+#define IR_LIB_WAKE_LATENCY_US 500
+#else
+#define IR_LIB_WAKE_LATENCY_US 20
+#endif
+#endif
+#ifndef IR_LIB_LEARNED_CODES // Fingerprints learnCode() can hold, a power of two; 0 turns learning off
+#if defined(__AVR__)
+#define IR_LIB_LEARNED_CODES 8
+#else
+#define IR_LIB_LEARNED_CODES 64
+#endif
+#endif
+#ifndef IR_LIB_FINGERPRINT_MIN_PAIRS
+#define IR_LIB_FINGERPRINT_MIN_PAIRS 8 // Shorter frames are too alike to fingerprint
+#endif
+#ifndef IR_LIB_CAPTURE_CHUNK
+#define IR_LIB_CAPTURE_CHUNK 32 // Bytes of capture data buffered before each write to the output
+#endif
+
+// --- Binary Capture Format ---
+// Each burst is an 11 byte header: 'I' 'R' 'C', version, IRCapturePlatform, pin, flags and the
+// millis() of the recording as uint32 little endian. Then one unsigned LEB128 varint per
+// duration in microseconds, alternating mark/space from the first mark, and a 0 ending the
+// burst. Durations of 0 are stored as 1. Bursts follow each other in the same stream.
+#define IR_CAPTURE_FORMAT_VERSION 1
+#define IR_CAPTURE_HEADER_SIZE 11
+#define IR_CAPTURE_FLAG_SATURATED 0x01 // Compact ring: 32767 means 32767 us or longer
+enum IRCapturePlatform : uint8_t {
+  IR_PLATFORM_UNKNOWN = 0,
+  IR_PLATFORM_AVR,
+  IR_PLATFORM_ESP8266,
+  IR_PLATFORM_ESP32,
+  IR_PLATFORM_STM32,
+  IR_PLATFORM_HOST
+};
+
+// One ring entry per edge. Full entries hold the 31-bit micros() timestamp of the edge; compact
+// entries hold the 15-bit duration since the previous edge, saturating at IR_DURATION_LONG_GAP.
+// Both keep the edge direction in the top bit.
+#if IR_LIB_COMPACT_DURATIONS
+typedef uint16_t ir_raw_t;
+#else
+typedef uint32_t ir_raw_t;
+#endif
 
 // Struct to hold pulse and space pairs
 struct PulseSpacePair {
@@ -16,125 +159,371 @@ struct PulseSpacePair {
     int space;
 };
 
-// Enum for remote brands
-#ifndef REMOTEBRAND_ENUM
-#define REMOTEBRAND_ENUM
-enum RemoteBrand {
-  UNKNOWN = 0, 
-  JVC,
-  SONY,
-  NEC,
-  NUM_BRANDS
+// How edges are timestamped, selected in begin()
+enum IRCaptureMode {
+  IR_CAPTURE_PIN_INTERRUPT = 0, // attachInterrupt() + micros(), any interrupt capable pin
+  IR_CAPTURE_HW_TIMER,          // Peripheral timestamping: RMT (ESP32), timer input capture (STM32), ICP1 on pin 8 (ATmega328)
+  IR_CAPTURE_REPLAY             // No interrupt and no ISR slot: edges only come from replayTransition()
+};
+
+// What a DecodedIR reports. Without setHoldEvents() every burst yields one IR_EVENT_CODE.
+enum IREventType : uint8_t {
+  IR_EVENT_CODE = 0,  // Whole burst, decoded once it ended (hold events off)
+  IR_EVENT_PRESS,     // First frame of a button press
+  IR_EVENT_REPEAT,    // Each repeat frame while the button is held
+  IR_EVENT_RELEASE    // No more frames for IR_LIB_IDLE_TIMEOUT_MS
 };
-#endif
 
 // Struct to hold decoded command and address
 struct DecodedIR {
   RemoteBrand brand = UNKNOWN;
   int command = -1;
   int address = -1;
+  unsigned long timestamp = 0; // millis() of the last edge of the burst it was decoded from
+  uint8_t repeatCount = 0;     // Frames after the first that repeated this code (NEC ditto frames included)
+  bool checksumValid = false;  // NEC inverted command matched; always false for protocols without a checksum
+  IREventType event = IR_EVENT_CODE;
 };
 
+// Receiver health counters, see getStats(). Counted since construction or resetStats().
+struct IRStats {
+  uint32_t edgesCaptured = 0;            // Edges stored in the ring
+  uint32_t edgesDropped = 0;             // Edges lost because the ring was full
+  uint32_t glitchesFiltered = 0;         // Marks shorter than the glitch filter, dropped with both edges
+  uint16_t peakRingFill = 0;             // Most ring entries in use at once (IR_LIB_MAX_TRANSITIONS - 1 is full)
+  uint32_t burstsAnalyzed = 0;           // Bursts that ended, including those already decoded by streaming
+  uint32_t burstsUndecoded = 0;          // Bursts that yielded no code
+  uint16_t protocolWins[NUM_BRANDS] = {}; // Decoded bursts per RemoteBrand
+  uint16_t checksumFailures = 0;         // Frames whose inverted command did not match (NEC)
+  uint32_t maxAnalysisMicros = 0;        // Longest whole-burst analysis, all passes of the burst together
+  uint32_t averageAnalysisMicros = 0;    // Over the bursts that needed whole-burst analysis
+  uint32_t fastPathPasses = 0;           // Analysis passes resolved by early dispatch alone
+  uint32_t noisePasses = 0;              // Analysis passes that looked like no protocol and were not scored
+  uint32_t learnedMatches = 0;           // Bursts reported as LEARNED codes
+  uint32_t wakeups = 0;                  // sleepUntilIR() wake-ups that ended with the next sleep
+  uint32_t lastWakeMicros = 0;           // Time awake for the last of them
+  uint32_t averageWakeMicros = 0;
+};
+
+// Invoked by dispatchCodes() (or the decode task) once per decoded code
+typedef void (*IRCodeCallback)(const DecodedIR& code);
+// Receives binary capture data in chunks, from isCode() and never from the ISR
+typedef void (*IRCaptureDataCallback)(const uint8_t* data, size_t length);
+
 class IRReceiver {
 public:
     IRReceiver();
+    ~IRReceiver();
 
-    bool begin(int pin);
+    bool begin(int pin, IRCaptureMode mode = IR_CAPTURE_PIN_INTERRUPT);
     bool isCode();
     DecodedIR getCode();
+    int getCodes(DecodedIR codes[], int maxCodes);
+    uint16_t getOverflowCount() const;
+    IRStats getStats() const;
+    void resetStats();
     const char* brandToString(RemoteBrand brand) const;
+    // The pointer forms are not thread-safe: unknown codes, and flash names on AVR and ESP8266,
+    // are formatted into one static buffer shared by every receiver. Tasks use the buffer forms.
     const char* getButtonName(RemoteBrand brand, int commandCode) const;
+    size_t getButtonName(RemoteBrand brand, int commandCode, char* buffer, size_t bufferSize) const;
+    const char* getButtonName(const DecodedIR& code) const;
+    size_t getButtonName(const DecodedIR& code, char* buffer, size_t bufferSize) const;
+    const char* getRemoteName(const DecodedIR& code) const;
+    static bool addRemote(RemoteBrand brand, int address, const IrButton buttons[], size_t count,
+                          const char* name = nullptr, bool inFlash = IR_BUTTONS_IN_PROGMEM);
+    static int loadRemotes(Stream& input);
     void enable();
     void disable();
+    void setStreamingDecode(bool enabled);
+    void replayTransition(uint32_t timestampMicros, int pinLevel);
+    void setHoldEvents(bool enabled);
+    void setGlitchFilter(uint16_t minPulseMicros);
+    void setEarlyCommit(uint8_t frames);
+    void onCode(IRCodeCallback callback);
+    void onCaptureData(IRCaptureDataCallback callback);
+    void setCaptureOutput(Print* output);
+    int dispatchCodes();
+#if IR_LIB_LEARNED_CODES > 0
+    void learnCode(int command);
+    bool isLearning() const;
+    uint32_t getLastFingerprint() const;
+    static bool addLearnedCode(uint32_t fingerprint, int command);
+    static bool findLearnedCode(uint32_t fingerprint, int& command);
+    static void clearLearnedCodes();
+#endif
+#if IR_LIB_LOW_POWER
+    bool readyToSleep() const;
+    bool sleepUntilIR();
+#endif
+#if IR_LIB_HAS_FREERTOS
+    bool startDecodeTask(QueueHandle_t codeQueue = nullptr, UBaseType_t priority = 1, int core = IR_LIB_DECODE_TASK_CORE);
+    void stopDecodeTask();
+#endif
+#if IR_LIB_TRACE
+    size_t traceDrain(Print& output, size_t maxRecords = IR_LIB_TRACE_DEPTH);
+    size_t traceRead(IrTraceRecord records[], size_t maxRecords);
+    uint16_t traceDropped() const;
+#endif
 
 private:
-    // Protocol Definitions
-    static constexpr int JVC_PREAMBLE_PULSE = 8400; /* ... all other protocol constants ... */
-    static constexpr int JVC_PREAMBLE_SPACE = 4200;
-    static constexpr int JVC_BIT_PULSE = 526;
-    static constexpr int JVC_ZERO_SPACE = 526;
-    static constexpr int JVC_ONE_SPACE = 1574;
-    static constexpr int JVC_REPEAT_DELAY = 22000;
-    static constexpr int JVC_REPEAT_PREAMBLE_PULSE = 0;
-    static constexpr int JVC_REPEAT_PREAMBLE_SPACE = 0;
-    static constexpr int JVC_INITIAL_BITS = 17;
-    static constexpr int JVC_REPEAT_BITS = 16;
-
-    static constexpr int SONY_PREAMBLE_PULSE = 2400;
-    static constexpr int SONY_PREAMBLE_SPACE = 600;
-    static constexpr int SONY_ZERO_PULSE = 600;
-    static constexpr int SONY_ONE_PULSE = 1200;
-    static constexpr int SONY_BIT_SPACE = 600;
-    static constexpr int SONY_REPEAT_DELAY = 25000;
-    static constexpr int SONY_REPEAT_PREAMBLE_PULSE = 2400;
-    static constexpr int SONY_REPEAT_PREAMBLE_SPACE = 600;
-    static constexpr int SONY_INITIAL_BITS = 13;
-    static constexpr int SONY_REPEAT_BITS = 13;
-
-    static constexpr int NEC_PREAMBLE_PULSE = 9000;
-    static constexpr int NEC_PREAMBLE_SPACE = 4500;
-    static constexpr int NEC_BIT_PULSE = 563;
-    static constexpr int NEC_ZERO_SPACE = 563;
-    static constexpr int NEC_ONE_SPACE = 563 * 3;
-    static constexpr int NEC_REPEAT_DELAY = 42000;
-    static constexpr int NEC_REPEAT_PREAMBLE_PULSE = 8900;
-    static constexpr int NEC_REPEAT_PREAMBLE_SPACE = 2200;
-    static constexpr int NEC_INITIAL_BITS = 33; 
-    static constexpr int NEC_REPEAT_BITS = 1;   
-
-    // Analysis Configuration
-    static constexpr int TIMING_TOLERANCE = 200;
-    static constexpr float PERCENTAGE_TOLERANCE = 0.10f; 
-    static constexpr int MIN_REPEAT_GAP = 10000;
+    // Analysis Configuration (protocol timing lives in IR_PROTOCOLS, see IRProtocolDefs.cpp)
+    static constexpr int TIMING_TOLERANCE = IR_LIB_TIMING_TOLERANCE; // Per-duration windows come from IR_TIMING()
+    static constexpr int MIN_REPEAT_GAP = 10000; // Any longer space ends a frame, for every protocol
 
     // Raw Capture
-    static IRReceiver* s_instance; 
+    static IRReceiver* s_instances[IR_LIB_MAX_RECEIVERS]; // Indexed by ISR trampoline slot
+    int m_isrSlot;                                        // -1 until begin() claims a slot
     int m_irPin;
-    volatile uint32_t m_rawTransitions[IR_LIB_MAX_TRANSITIONS];
-    volatile int m_rawTransitionIndex;
+#if IR_LIB_FAST_PIN_READ
+    const volatile ir_port_t* m_pinInputRegister; // nullptr falls back to digitalRead()
+    ir_port_t m_pinBitMask;
+#endif
+    // Single-producer/single-consumer ring: the ISR only writes m_rawHead,
+    // isCode() only writes m_rawTail. No interrupt masking is needed.
+    volatile ir_raw_t m_rawTransitions[IR_LIB_MAX_TRANSITIONS];
+    volatile uint16_t m_rawHead;
+    volatile uint16_t m_rawTail;
     volatile unsigned long m_lastTransitionMillis;
     volatile int m_lastPinState;
-    bool m_rawBurstCopied; 
+    volatile uint32_t m_heldMarkMicros; // Start of the mark in progress, stored once it ends
+    volatile bool m_heldMarkKnown;      // False for a mark already in progress at enable()
+    volatile uint16_t m_minPulseMicros; // Glitch filter threshold
+#if IR_LIB_COMPACT_DURATIONS
+    volatile uint32_t m_lastEdgeMicros; // Compact entries are relative to the previous edge
+#endif
+    volatile uint32_t m_edgesCaptured;  // Statistics kept by the ISR, never written elsewhere
+    volatile uint32_t m_edgesDropped;
+    volatile uint32_t m_glitchesFiltered;
+    volatile uint16_t m_peakRingFill;   // Except here: resetStats() clears it
 
     // Analysis & Decoding Data
+#if IR_LIB_COMPACT_DURATIONS
+    uint16_t m_pairRingStart;       // Pairs are read straight from the ring, from this entry on
+    int m_pairEntryCount;           // Ring entries in the burst under analysis
+#else
     PulseSpacePair m_pulseSpacePairs[IR_LIB_MAX_TRANSITIONS / 2];
+#endif
+#if IR_LIB_SYMBOL_STREAM
+    uint8_t m_pairSymbols[IR_LIB_MAX_TRANSITIONS / 2][2]; // Pulse and space symbol of each pair
+#endif
     int m_pulseSpacePairCount;
+
+    // Segment index built once per burst and shared by all scorers and decoders.
+    // Mark/space spreads exclude the first pair when it matched a preamble, and the
+    // space that terminates the segment.
+    struct BurstSegment {
+        uint8_t start;          // First pair index
+        uint8_t end;            // Last pair index (inclusive)
+        RemoteBrand preamble;   // matchPreamble() of the first pair (repeat preamble after segment 0)
+        int minMark, maxMark;
+        int minSpace, maxSpace; // minSpace > maxSpace when the segment has no data spaces
+    };
+    // One protocol's view of a segment: the first pair only counts as a preamble if it is its own.
+    struct SegmentView {
+        int dataStart;
+        int dataCount;
+        int pairCount;
+        bool hasPreamble;
+        bool marksFixed;        // All data marks within 2 * TIMING_TOLERANCE of each other
+        bool spacesFixed;       // Same for data spaces; false when there are none
+    };
+    BurstSegment m_segments[IR_LIB_MAX_SEGMENTS];
+    int m_segmentCount;
+
+    // Burst Accumulators. Frames are analyzed as soon as the gap after them arrives and their
+    // ring slots are released, so only these survive until the burst ends.
+    struct FrameVote { int command; int address; uint8_t count; bool checksumValid; };
     int m_brandScores[NUM_BRANDS];
-    DecodedIR m_decodedSegments[IR_LIB_MAX_DECODED_SEGMENTS]; 
-    int m_decodedSegmentCount;
-    DecodedIR m_finalResultCode; 
-    bool m_codeResultIsReady;    
+    FrameVote m_frameVotes[NUM_BRANDS][IR_LIB_MAX_FRAME_VOTES];
+    uint8_t m_frameVoteCount[NUM_BRANDS];
+    uint8_t m_dittoFrames[NUM_BRANDS];   // Data-less repeat frames seen after the first frame
+    uint8_t m_agreeingFrames[NUM_BRANDS]; // Identical frames in a row, up to the last decoded one
+    uint8_t m_agreeingVote[NUM_BRANDS];  // Their entry in m_frameVotes
+    uint8_t m_burstFrameCount;           // Frames analyzed by earlier passes of this burst
+    int m_burstLastGap;                  // Space after the last frame analyzed, -1 when not seen
+    int m_gapBeforePass;                 // m_burstLastGap when the current pass started
+    uint16_t m_frameScanIndex;           // Next ring entry to check for a frame gap
+    ir_raw_t m_frameScanPrevValue;
+    bool m_frameScanHasPrev;
+    RemoteBrand m_dispatchBrand;         // Protocol earlier passes of this burst were dispatched to
+    bool m_dispatchActive;               // False once a pass of this burst needed full scoring
+    RemoteBrand m_lastWinnerBrand;       // Protocol of the last decoded burst, tried first
+    DecodedIR m_finalResultCode; // Winner of the burst being analyzed, queued by _queueCode()
+    DecodedIR m_codeQueue[IR_LIB_EVENT_QUEUE_DEPTH]; // FIFO of decoded codes, only touched outside the ISR
+    uint8_t m_codeQueueHead;
+    uint8_t m_codeQueueCount;
+    uint16_t m_codeQueueOverflows;
     bool m_isInterruptAttached; 
+    IRCaptureMode m_captureMode;
+
+    // Streaming Decode State (frames decoded edge by edge while the burst is still arriving)
+    struct StreamState { uint8_t phase; uint8_t bitCount; uint32_t rawBits; };
+    enum StreamResult : uint8_t { STREAM_NO_FRAME = 0, STREAM_FRAME, STREAM_DITTO_FRAME };
+    bool m_streamingEnabled;
+    uint16_t m_streamIndex;        // Next ring entry to feed to the stream decoders
+    ir_raw_t m_streamPrevValue;
+    bool m_streamPrevHighToLow;
+    bool m_streamHasPrev;
+    bool m_streamEmitted;          // A code was already published for the current burst
+    StreamState m_streamStates[NUM_BRANDS];
+
+    // Hold Tracking (press/repeat/release events, decoded frame by frame)
+    bool m_holdEventsEnabled;
+    bool m_holdActive;
+    DecodedIR m_heldCode;          // Carried forward across data-less repeat frames
+    uint8_t m_earlyCommitFrames;   // Agreeing frames that publish a code before the burst ends, 0 for off
+
+    // Event Delivery
+    IRCodeCallback m_codeCallback;
+#if IR_LIB_HAS_FREERTOS
+    TaskHandle_t volatile m_decodeTask; // Read by the ISR to decide whether to notify
+    QueueHandle_t m_decodeTaskQueue;    // Optional application queue of DecodedIR
+    volatile bool m_decodeTaskStopping;
+#endif
+#if IR_LIB_END_TIMER
+    esp_timer_handle_t m_endTimer;          // Armed by the first edge of a burst, see _endTimerFired()
+    volatile bool m_endTimerArmed;
+    volatile bool m_burstTimedOut;
+    volatile uint32_t m_lastTransitionMicros;
+    volatile uint32_t m_timedOutEdgeMicros; // Last edge when the timer found the line quiet
+#endif
+
+    // Statistics
+    IRStats m_stats;                     // Decode side counters; the ISR counts are merged in getStats()
+    uint32_t m_edgesCapturedBase;        // ISR counts at the last resetStats()
+    uint32_t m_edgesDroppedBase;
+    uint32_t m_glitchesFilteredBase;
+    uint32_t m_burstAnalysisMicros;      // Analysis time of the burst in progress
+    uint32_t m_analysisMicrosTotal;
+    uint32_t m_analysisBurstCount;
+#if IR_LIB_TRACE
+    mutable IrTraceRing m_trace;          // Filled by this receiver's decode path, const analysis included
+#endif
+
+    // Capture Recording (bursts exported in the binary capture format as their slots are released)
+    IRCaptureDataCallback m_captureCallback;
+    Print* m_captureOutput;
+    bool m_captureOpen;            // Header written for the current burst
+    uint16_t m_captureIndex;       // Next ring entry whose duration is recorded
+    ir_raw_t m_capturePrevValue;
+    uint8_t m_captureBuffer[IR_LIB_CAPTURE_CHUNK];
+    uint8_t m_captureLength;
+
+#if IR_LIB_LOW_POWER
+    // Low Power (IRLowPower.cpp)
+    bool m_awake;                  // Woken by sleepUntilIR() and not back asleep yet
+    uint32_t m_wakeStartMicros;
+    uint32_t m_wakeMicrosTotal;
+#endif
+
+#if IR_LIB_LEARNED_CODES > 0
+    // Learned Codes (IRLearn.cpp)
+    int m_learnCommand;            // Command the next undecoded burst is learned as, -1 when not learning
+    uint32_t m_burstFingerprint;   // First fingerprint of the burst in progress, 0 until a frame qualifies
+    uint32_t m_lastFingerprint;    // Of the last burst no protocol decoded
+#endif
 
     // ISR Methods (NO IRAM_ATTR in declarations)
-    static void staticHandleIrInterrupt_priv(); 
+    template<int Slot> static void staticHandleIrInterrupt_priv(); 
+    static void (* const s_isrTrampolines[])();
     void handleIrInterrupt_priv(); 
+    int _readPin() const;
+    void _pushTransition(uint32_t currentTimeMicros, int currentState);
+    void _storeEdge(uint32_t edgeMicros, bool highToLow);
+    void _restartIdleTimeout(uint32_t edgeMicros);
+    void _notifyDecodeTaskFromISR(bool burstStarted);
+#if IR_LIB_HAS_FREERTOS
+    static void _decodeTaskEntry(void* receiver);
+    void _decodeTaskLoop();
+#endif
+#if IR_LIB_END_TIMER
+    static void _endTimerFired(void* receiver);
+#endif
+
+    // Hardware Capture Backends (IRCapture.cpp)
+    friend struct IRHardwareCapture;
+    bool _attachHardwareCapture();
+    void _detachHardwareCapture();
+    void _pollHardwareCapture();
+#if IR_LIB_LOW_POWER
+    bool _enterSleep();
+#endif
 
     // Internal Processing Methods
-    void _processRawTransitionsToPairs(const uint32_t localTransitions[], int capturedCount);
-    void _analyzeAndDecodeBurst();
+    void _processRawTransitionsToPairs(uint16_t startIndex, uint16_t endIndex);
+    PulseSpacePair _pair(int index) const;
+    int _segmentGap(const BurstSegment& segment) const;
+    bool _repeatGapMatches(const IrProtocol& protocol, int gapMicros) const;
+#if IR_LIB_SYMBOL_STREAM
+    void _quantizePairs();
+#endif
+    bool _pairMatches(int index, bool space, const IrProtocol& protocol, IrTimingSlot slot) const;
+    void _segmentBurst();
+    bool _plausiblePass() const;
+    void _resetBurst(uint16_t index);
+    bool _findFrameBoundary(uint16_t endIndex, uint16_t& boundary);
+    void _analyzeFrames(uint16_t startIndex, uint16_t endIndex);
+    void _voteFrames(const IrProtocol& protocol);
+    void _finishBurst();
+    void _commitBurst();
+    RemoteBrand _leadingBrand(int& score) const;
+    void _queueBurstCode();
+#if IR_LIB_LEARNED_CODES > 0
+    uint32_t _fingerprintPass() const;
+    void _finishLearnedBurst();
+#endif
+    void _resetStream(uint16_t index);
+    void _streamRawTransitions(uint16_t endIndex);
+    StreamResult _streamFeed(const IrProtocol& protocol, StreamState& state, bool isMark, int duration);
+    void _holdFrame(const DecodedIR& code);
+    void _holdRepeat(RemoteBrand brand);
+    void _holdRelease();
+    void _queueCode(const DecodedIR& code);
+    void _timedAnalyzeFrames(uint16_t startIndex, uint16_t endIndex);
+    void _countBurst(bool analyzed);
+    void _recordCapture(uint16_t endIndex, bool burstEnded);
+    void _captureByte(uint8_t value);
+    void _captureVarint(uint32_t value);
+    void _flushCapture();
+    void _clearCodeQueue();
 
     // Helper Methods
+    uint16_t _loadRawHead() const;
+    void _storeRawTail(uint16_t tail);
+    bool _burstIdle() const;
     bool isWithinTolerance(int captured, int expected, int tolerance) const;
-    bool isWithinPercentageTolerance(int captured, int expected, float tolerance_percent) const;
-    RemoteBrand matchPreamble(int pulse, int space, bool isRepeatPreamble) const;
+    static const IrProtocol* findProtocol(RemoteBrand brand);
+    const IrButton* _lookupButton(RemoteBrand brand, int address, int commandCode, bool& inFlash) const;
+    size_t _formatButtonName(RemoteBrand brand, int address, int commandCode, char* buffer, size_t bufferSize) const;
+    const char* _buttonName(RemoteBrand brand, int address, int commandCode) const;
+    RemoteBrand matchPreamble(int index, bool isRepeatPreamble) const;
 
     // Scoring Functions
-    int scoreSonySIRC12(const PulseSpacePair pairs[], int count) const;
-    int scoreJVC(const PulseSpacePair pairs[], int count) const;
-    int scoreNEC(const PulseSpacePair pairs[], int count) const;
+    SegmentView viewSegment(const BurstSegment& segment, RemoteBrand brand) const;
+    int scoreProtocol(const IrProtocol& protocol, const BurstSegment segments[], int count) const;
+    int maxProtocolScore(const IrProtocol& protocol, int count) const;
+    bool _dispatchPass();
 
-    // Decoding Function
-    DecodedIR decodeWinningSegment(RemoteBrand brand, const PulseSpacePair pairs[], int count) const;
-    struct DecodedNECInternal { DecodedIR base; bool checksumValid = false; };
-    DecodedNECInternal decodeNECData(const PulseSpacePair dataPairs[], int dataPairCount) const; 
+    // Decoding Functions
+    struct DecodedFrameInternal { DecodedIR base; bool checksumValid = false; };
+    DecodedFrameInternal decodeSegment(const IrProtocol& protocol, int firstPair, int dataPairCount) const;
+    DecodedFrameInternal fieldsFromBits(const IrProtocol& protocol, uint32_t rawBits, int bitCount) const;
 
     // Winner Determination
-    void determineWinner(const DecodedIR segments[], int count, const bool segmentChecksums[]);
+    void determineWinner(RemoteBrand brand, const FrameVote votes[], int count);
 
     // Constants for Time/Direction Packing
-    static constexpr uint32_t TIME_VALUE_MASK = 0x7FFFFFFF;
-    static constexpr uint32_t DIRECTION_FLAG_H_TO_L = 0x80000000;
+#if IR_LIB_COMPACT_DURATIONS
+    static constexpr ir_raw_t TIME_VALUE_MASK = 0x7FFF;         // Duration since the previous edge
+    static constexpr ir_raw_t DIRECTION_FLAG_H_TO_L = 0x8000;
+    static constexpr ir_raw_t IR_DURATION_LONG_GAP = 0x7FFF;    // Any longer duration, always a frame gap
+#else
+    static constexpr ir_raw_t TIME_VALUE_MASK = 0x7FFFFFFF;     // micros() timestamp
+    static constexpr ir_raw_t DIRECTION_FLAG_H_TO_L = 0x80000000;
+#endif
+    static uint32_t transitionDelta(uint32_t previousTimeVal, uint32_t currentTimeVal);
+    static uint32_t entryDuration(ir_raw_t previousValue, ir_raw_t currentValue);
 };
 
 #endif // IR_RECEIVER_H
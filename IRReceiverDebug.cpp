@@ -0,0 +1,128 @@
+#include "IRReceiver.h"
+
+#if IR_LIB_TRACE
+
+#if defined(__AVR__)
+#define IR_TRACE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define IR_TRACE_BARRIER() __sync_synchronize()
+#endif
+
+// Labels used by drain(); nullptr leaves the argument out.
+struct IrTraceFormat { const char* name; const char* aLabel; const char* bLabel; };
+static const IrTraceFormat TRACE_FORMATS[IR_TRACE_EVENT_COUNT] = {
+    { "BURST_END", "entries", nullptr },
+    { "BURST_STREAMED", nullptr, nullptr },
+    { "FRAMES", "pairs", "earlierFrames" },
+    { "PAIRS_FULL", "dropped", nullptr },
+    { "SEGMENTS_FULL", "fromPair", nullptr },
+    { "SCORE", "score", nullptr },
+    { "BIT_ERROR", "bit", "us" },
+    { "FRAME", "command", "address" },
+    { "WINNER", "score", nullptr },
+    { "NO_WINNER", nullptr, nullptr },
+    { "CODE", "command", "address" },
+    { "STREAM_CODE", "command", "address" },
+    { "STREAM_CHECKSUM", "command", nullptr },
+    { "QUEUE_OVERFLOW", "dropped", nullptr },
+    { "NOISE", "pairs", "frames" },
+    { "LEARN", "command", "fingerprint" },
+    { "COMMIT", "command", "frames" },
+};
+
+static uint8_t nextTraceIndex(uint8_t index) {
+    return (index + 1 < IR_LIB_TRACE_DEPTH) ? index + 1 : 0;
+}
+
+void IrTraceRing::record(uint8_t event, uint8_t brand, int32_t a, int32_t b) {
+    uint8_t head = m_head;
+    uint8_t nextHead = nextTraceIndex(head);
+    if (nextHead == m_tail) { // Full: keep the older records, they explain what came next
+        if (m_dropped != 0xFFFF) m_dropped = m_dropped + 1;
+        return;
+    }
+    IrTraceRecord& record = m_records[head];
+    record.micros = micros();
+    record.event = event;
+    record.brand = brand;
+    record.a = a;
+    record.b = b;
+    IR_TRACE_BARRIER(); // Record must be complete before the reader sees the new head
+    m_head = nextHead;
+}
+
+size_t IrTraceRing::read(IrTraceRecord records[], size_t maxRecords) {
+    size_t count = 0;
+    uint8_t tail = m_tail;
+    while (count < maxRecords && tail != m_head) {
+        IR_TRACE_BARRIER();
+        records[count++] = m_records[tail];
+        tail = nextTraceIndex(tail);
+    }
+    IR_TRACE_BARRIER(); // Done reading before the slots are handed back
+    m_tail = tail;
+    return count;
+}
+
+static const char* traceBrandName(uint8_t brand) {
+    if (brand == LEARNED) return "LEARNED";
+    for (size_t i = 0; i < IR_PROTOCOLS_COUNT; i++) {
+        if (IR_PROTOCOLS[i].brand == brand) return IR_PROTOCOLS[i].name;
+    }
+    return "UNKNOWN";
+}
+
+// Format: "<micros> <EVENT> [<BRAND>] [label=value ...]"
+size_t IrTraceRing::drain(Print& output, size_t maxRecords) {
+    size_t printed = 0;
+    IrTraceRecord record;
+    while (printed < maxRecords && read(&record, 1) == 1) {
+        printed++;
+        output.print(record.micros);
+        output.print(' ');
+        if (record.event >= IR_TRACE_EVENT_COUNT) {
+            output.print("EVENT_");
+            output.println((int)record.event);
+            continue;
+        }
+        const IrTraceFormat& format = TRACE_FORMATS[record.event];
+        output.print(format.name);
+        if (record.brand != 0) {
+            output.print(' ');
+            output.print(traceBrandName(record.brand));
+        }
+        if (format.aLabel != nullptr) {
+            output.print(' ');
+            output.print(format.aLabel);
+            output.print('=');
+            output.print(record.a);
+        }
+        if (format.bLabel != nullptr) {
+            output.print(' ');
+            output.print(format.bLabel);
+            output.print('=');
+            output.print(record.b);
+        }
+        output.println();
+    }
+    uint16_t dropped = m_dropped;
+    if (dropped != m_droppedReported) {
+        output.print("TRACE_DROPPED ");
+        output.println((unsigned int)(uint16_t)(dropped - m_droppedReported));
+        m_droppedReported = dropped;
+    }
+    return printed;
+}
+
+size_t IRReceiver::traceDrain(Print& output, size_t maxRecords) {
+    return m_trace.drain(output, maxRecords);
+}
+
+size_t IRReceiver::traceRead(IrTraceRecord records[], size_t maxRecords) {
+    return m_trace.read(records, maxRecords);
+}
+
+uint16_t IRReceiver::traceDropped() const {
+    return m_trace.dropped();
+}
+#endif // IR_LIB_TRACE
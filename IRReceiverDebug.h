@@ -54,4 +54,75 @@ template<typename T, typename... Args> void debug_print_recursive(T first_arg, A
 #define Debug(flag, ...)
 #endif
 
+// --- Binary Trace Log ---
+// Debug() prints while decoding, which changes timing. Trace() instead stores a small record
+// (event id, brand and two integers) in the receiver's own RAM ring, and
+// IRReceiver::traceDrain() formats the records later, e.g. from loop(). Set IR_LIB_TRACE to 1
+// to enable; when 0, Trace() compiles away.
+#ifndef IR_LIB_TRACE
+#define IR_LIB_TRACE 0
+#endif
+#ifndef IR_LIB_TRACE_DEPTH
+#if defined(__AVR__)
+#define IR_LIB_TRACE_DEPTH 16 // Records kept until drained (at most 255); newer ones are dropped
+#else
+#define IR_LIB_TRACE_DEPTH 128
+#endif
+#endif
+
+enum IRTraceEvent : uint8_t {
+  IR_TRACE_BURST_END = 0,   // a: ring entries in the burst
+  IR_TRACE_BURST_STREAMED,  // Burst ended and was already published by the stream decoders or an early commit
+  IR_TRACE_FRAMES,          // a: pulse/space pairs, b: frames analyzed before this pass
+  IR_TRACE_PAIRS_FULL,      // a: ring entries that did not fit
+  IR_TRACE_SEGMENTS_FULL,   // a: first pair index ignored
+  IR_TRACE_SCORE,           // brand, a: score of this pass
+  IR_TRACE_BIT_ERROR,       // brand, a: bit index, b: offending duration in us
+  IR_TRACE_FRAME,           // brand, a: command, b: address of one decoded frame
+  IR_TRACE_WINNER,          // brand, a: total score
+  IR_TRACE_NO_WINNER,
+  IR_TRACE_CODE,            // brand, a: command, b: address queued for the burst
+  IR_TRACE_STREAM_CODE,     // brand, a: command, b: address published by the stream decoders
+  IR_TRACE_STREAM_CHECKSUM, // brand, a: command that failed its checksum
+  IR_TRACE_QUEUE_OVERFLOW,  // a: codes dropped so far
+  IR_TRACE_NOISE,           // a: pairs, b: frames of a pass rejected before scoring
+  IR_TRACE_LEARN,           // a: command stored, b: fingerprint
+  IR_TRACE_COMMIT,          // brand, a: command, b: agreeing frames of a code published before the burst ended
+  IR_TRACE_EVENT_COUNT
+};
+
+struct IrTraceRecord {
+  uint32_t micros;
+  uint8_t event;            // IRTraceEvent
+  uint8_t brand;            // RemoteBrand, 0 when the event has none
+  int32_t a;
+  int32_t b;
+};
+
+#if IR_LIB_TRACE
+// Each receiver owns one ring, so receivers decoding on different tasks or threads never write
+// the same record. Single producer (that receiver's decode path) and single consumer (its
+// traceDrain() or traceRead()), no locking.
+class IrTraceRing {
+public:
+    void record(uint8_t event, uint8_t brand, int32_t a, int32_t b);
+    // Prints up to maxRecords records, oldest first, one line each. Returns the number printed.
+    size_t drain(Print& output, size_t maxRecords);
+    // Copies up to maxRecords raw records, oldest first, for custom formatting or logging.
+    size_t read(IrTraceRecord records[], size_t maxRecords);
+    uint16_t dropped() const { return m_dropped; } // Records lost because the ring was full
+
+private:
+    IrTraceRecord m_records[IR_LIB_TRACE_DEPTH];
+    volatile uint8_t m_head = 0;      // Written by record() only
+    volatile uint8_t m_tail = 0;      // Written by the readers only
+    volatile uint16_t m_dropped = 0;  // Written by record() only, saturates
+    uint16_t m_droppedReported = 0;   // Reader side copy for drain()
+};
+// Only used inside IRReceiver members, which trace into their own ring.
+#define Trace(event, brand, a, b) this->m_trace.record((event), (uint8_t)(brand), (int32_t)(a), (int32_t)(b))
+#else
+#define Trace(event, brand, a, b) do {} while (0)
+#endif
+
 #endif // DEBUG_H
@@ -0,0 +1,177 @@
+#ifndef IR_BENCH_CAPTURES_H
+#define IR_BENCH_CAPTURES_H
+
+// Reference captures for the decode benchmark, shared by the DecodeBenchmark sketch and the
+// host replay harness in extras/host. Captures are built from nominal protocol timing plus
+// a fixed pseudo-random jitter, so every run replays exactly the same edges.
+
+#include <IRReceiver.h>
+
+#ifndef IR_BENCH_MAX_DURATIONS
+#define IR_BENCH_MAX_DURATIONS 200 // Longest capture, in marks plus spaces
+#endif
+#ifndef IR_BENCH_JITTER_US
+#define IR_BENCH_JITTER_US 60 // Receivers typically stretch or shorten marks by this much
+#endif
+
+// Alternating mark/space durations in microseconds, starting with a mark.
+class CaptureBuilder {
+public:
+    CaptureBuilder(uint32_t durations[], size_t capacity, uint32_t seed)
+        : m_durations(durations), m_capacity(capacity), m_count(0), m_seed(seed) {}
+
+    void mark(uint32_t us) { _append(us, (m_count % 2) == 0); }
+    void space(uint32_t us) { _append(us, (m_count % 2) == 1); }
+    void spike(uint32_t us) { // Short mark with no jitter, like the noise from lighting
+        if ((m_count % 2) == 0 && m_count < m_capacity) m_durations[m_count++] = us;
+    }
+    size_t count() const { return m_count; }
+
+private:
+    void _append(uint32_t us, bool expectedPhase) {
+        if (!expectedPhase || m_count >= m_capacity) return; // Keeps marks on even indices
+        m_seed = m_seed * 1103515245UL + 12345UL;
+        int jitter = (int)((m_seed >> 16) % (2 * IR_BENCH_JITTER_US + 1)) - IR_BENCH_JITTER_US;
+        m_durations[m_count++] = (us > 10000) ? us : (uint32_t)((int)us + jitter); // Gaps are not jittered
+    }
+
+    uint32_t* m_durations;
+    size_t m_capacity;
+    size_t m_count;
+    uint32_t m_seed;
+};
+
+// With spikeEvery, every spikeEvery-th space is split in half by a 30 us spike.
+inline void buildDistanceBits(CaptureBuilder& capture, uint32_t bits, int count, uint32_t pulse, uint32_t zero, uint32_t one,
+                              int spikeEvery = 0) {
+    for (int i = 0; i < count; i++) {
+        uint32_t space = ((bits >> i) & 1) ? one : zero;
+        capture.mark(pulse);
+        if (spikeEvery > 0 && i % spikeEvery == spikeEvery - 1) {
+            capture.space(space / 2);
+            capture.spike(30);
+            capture.space(space - space / 2 - 30);
+        } else {
+            capture.space(space);
+        }
+    }
+    capture.mark(pulse); // Stop bit
+}
+
+// NEC frame followed by `repeats` ditto frames, one every 108 ms.
+inline void buildNec(CaptureBuilder& capture, uint8_t address, uint8_t command, int repeats, int spikeEvery = 0) {
+    uint32_t bits = address | ((uint32_t)(uint8_t)~address << 8) | ((uint32_t)command << 16) | ((uint32_t)(uint8_t)~command << 24);
+    capture.mark(9000);
+    capture.space(4500);
+    buildDistanceBits(capture, bits, 32, 563, 563, 1689, spikeEvery);
+    for (int i = 0; i < repeats; i++) {
+        capture.space(i == 0 ? 40000 : 96000);
+        capture.mark(9000);
+        capture.space(2250);
+        capture.mark(563);
+    }
+}
+
+// JVC frame followed by `repeats` frames without preamble.
+inline void buildJvc(CaptureBuilder& capture, uint8_t address, uint8_t command, int repeats) {
+    uint32_t bits = address | ((uint32_t)command << 8);
+    capture.mark(8400);
+    capture.space(4200);
+    buildDistanceBits(capture, bits, 16, 526, 526, 1574);
+    for (int i = 0; i < repeats; i++) {
+        capture.space(22000);
+        buildDistanceBits(capture, bits, 16, 526, 526, 1574);
+    }
+}
+
+// SIRC-12 frame sent `frames` times, 25 ms apart.
+inline void buildSony(CaptureBuilder& capture, uint8_t address, uint8_t command, int frames) {
+    uint32_t bits = (command & 0x7F) | ((uint32_t)(address & 0x1F) << 7);
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame > 0) capture.space(25000);
+        capture.mark(2400);
+        for (int i = 0; i < 12; i++) {
+            capture.space(600);
+            capture.mark(((bits >> i) & 1) ? 1200 : 600);
+        }
+    }
+}
+
+// Random edges that match no protocol, e.g. from fluorescent lights.
+inline void buildNoise(CaptureBuilder& capture, int edges) {
+    uint32_t seed = 0xC0FFEE;
+    for (int i = 0; i < edges; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        uint32_t us = 150 + (seed >> 16) % 3000;
+        if (i % 2 == 0) capture.mark(us);
+        else capture.space(us);
+    }
+}
+
+struct BenchCase {
+    const char* name;
+    RemoteBrand brand;       // Expected first code; UNKNOWN expects nothing decoded
+    int address;
+    int command;
+    int codes;               // Expected number of codes (hold events off)
+    void (*build)(CaptureBuilder& capture);
+};
+
+#if IR_LIB_ENABLE_NEC
+inline void benchNecPress(CaptureBuilder& capture) { buildNec(capture, 0x04, 0x10, 0); }
+inline void benchNecHeld(CaptureBuilder& capture) { buildNec(capture, 0x04, 0x10, 8); }
+#if IR_LIB_MIN_PULSE_US > 0
+inline void benchNecSpikes(CaptureBuilder& capture) { // Spikes ahead of the frame and in its spaces
+    capture.spike(40);
+    capture.space(7000);
+    capture.spike(25);
+    capture.space(7000);
+    buildNec(capture, 0x04, 0x10, 0, 5);
+}
+#endif
+#endif
+#if IR_LIB_ENABLE_JVC
+inline void benchJvcHeld(CaptureBuilder& capture) { buildJvc(capture, 0x03, 0x0D, 4); }
+#endif
+#if IR_LIB_ENABLE_SONY
+inline void benchSonyPress(CaptureBuilder& capture) { buildSony(capture, 0x01, 21, 3); }
+#endif
+inline void benchNoise(CaptureBuilder& capture) { buildNoise(capture, 60); }
+
+const BenchCase BENCH_CASES[] = {
+#if IR_LIB_ENABLE_NEC
+    { "NEC press", NEC, 0x04, 0x10, 1, benchNecPress },
+    { "NEC held", NEC, 0x04, 0x10, 1, benchNecHeld },
+#if IR_LIB_MIN_PULSE_US > 0
+    { "NEC spikes", NEC, 0x04, 0x10, 1, benchNecSpikes },
+#endif
+#endif
+#if IR_LIB_ENABLE_JVC
+    { "JVC held", JVC, 0x03, 0x0D, 1, benchJvcHeld },
+#endif
+#if IR_LIB_ENABLE_SONY
+    { "SONY press", SONY, 0x01, 21, 1, benchSonyPress },
+#endif
+    { "noise", UNKNOWN, -1, -1, 0, benchNoise },
+};
+const size_t BENCH_CASE_COUNT = sizeof(BENCH_CASES) / sizeof(BenchCase);
+
+// Feeds a capture to the receiver edge by edge, and calls poll(timestampMicros) after each
+// edge the way loop() would call isCode(). Marks pull the pin LOW, as with a demodulating
+// receiver. Returns the timestamp of the last edge.
+template<typename Poll>
+uint32_t replayCapture(IRReceiver& receiver, const uint32_t durations[], size_t count, uint32_t startMicros, Poll poll) {
+    uint32_t now = startMicros;
+    for (size_t i = 0; i < count; i++) {
+        receiver.replayTransition(now, (i % 2 == 0) ? LOW : HIGH);
+        poll(now);
+        now += durations[i];
+    }
+    if (count % 2 == 1) { // Finish the last mark
+        receiver.replayTransition(now, HIGH);
+        poll(now);
+    }
+    return now;
+}
+
+#endif // IR_BENCH_CAPTURES_H
@@ -0,0 +1,84 @@
+/**
+ * @file DecodeBenchmark.ino
+ * @brief Measures decode cost on the target by replaying reference captures.
+ *
+ * Every capture in BenchCaptures.h is fed to the receiver with replayTransition() and the
+ * time spent in isCode() is reported per burst, in microseconds and CPU cycles, together
+ * with whether the expected code came out. The same captures run on a desktop with the
+ * host harness in extras/host, so results can be compared against a board.
+ *
+ * Leave BENCH_PIN unconnected: live edges would mix with the replayed ones.
+ */
+
+#include <IRReceiver.h>
+#include "BenchCaptures.h"
+
+const int BENCH_PIN = 4;       // Any interrupt-capable pin with nothing attached
+const int BENCH_ITERATIONS = 20;
+
+IRReceiver irReceiver;
+uint32_t durations[IR_BENCH_MAX_DURATIONS];
+
+// Time spent in isCode() for the current burst, and the codes it produced
+uint32_t decodeMicros;
+int codesSeen;
+DecodedIR firstCode;
+
+void poll(uint32_t) {
+  uint32_t start = micros();
+  bool ready = irReceiver.isCode();
+  decodeMicros += micros() - start;
+  while (ready) {
+    DecodedIR code = irReceiver.getCode();
+    if (codesSeen++ == 0) firstCode = code;
+    ready = irReceiver.isCode();
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  if (!irReceiver.begin(BENCH_PIN)) {
+    Serial.println("Error: IR Receiver initialization failed!");
+    while(1) delay(1000); // Halt on error
+  }
+
+  Serial.println("capture, edges, us/burst, cycles/burst, correct");
+  for (size_t i = 0; i < BENCH_CASE_COUNT; i++) {
+    const BenchCase& bench = BENCH_CASES[i];
+    CaptureBuilder capture(durations, IR_BENCH_MAX_DURATIONS, 1 + i);
+    bench.build(capture);
+
+    uint32_t totalMicros = 0;
+    int correct = 0;
+    for (int iter = 0; iter < BENCH_ITERATIONS; iter++) {
+      decodeMicros = 0;
+      codesSeen = 0;
+      replayCapture(irReceiver, durations, capture.count(), micros(), poll);
+      delay(IR_LIB_IDLE_TIMEOUT_MS + 1); // The idle timeout ends the burst
+      poll(micros());
+      totalMicros += decodeMicros;
+      if (codesSeen == bench.codes && (bench.codes == 0 || (firstCode.brand == bench.brand &&
+          firstCode.address == bench.address && firstCode.command == bench.command))) {
+        correct++;
+      }
+    }
+
+    uint32_t perBurst = totalMicros / BENCH_ITERATIONS;
+    Serial.print(bench.name);
+    Serial.print(", ");
+    Serial.print(capture.count() + 1);
+    Serial.print(", ");
+    Serial.print(perBurst);
+    Serial.print(", ");
+    Serial.print(perBurst * clockCyclesPerMicrosecond());
+    Serial.print(", ");
+    Serial.print(correct);
+    Serial.print("/");
+    Serial.println(BENCH_ITERATIONS);
+  }
+  Serial.print("Overflows: ");
+  Serial.println(irReceiver.getOverflowCount());
+}
+
+void loop() {
+}
@@ -51,7 +51,7 @@ void loop() {
         Serial.print(")");
 
         Serial.print(", Button: ");
-        Serial.println(irReceiver.getButtonName(result.brand, result.command));
+        Serial.println(irReceiver.getButtonName(result)); // Uses the remote registered for this address
     } else {
         // This might happen if the signal was too noisy or didn't match a known protocol well enough.
         Serial.println("Received IR burst, but could not decode a valid known signal.");
@@ -0,0 +1,45 @@
+/**
+ * @file LowPowerReceiver.ino
+ * @brief Battery powered receiver that sleeps between button presses.
+ *
+ * The MCU sleeps until the IR receiver pulls its pin low, decodes the burst, prints it and
+ * goes back to sleep, reporting how long each press kept it awake. The library must be built
+ * with -DIR_LIB_LOW_POWER=1 (e.g. build_flags in PlatformIO). On AVR the receiver pin needs a
+ * pin change interrupt as well as attachInterrupt(), so use pin 2 or 3.
+ */
+
+#include <IRReceiver.h>
+
+#if !IR_LIB_LOW_POWER
+#error "Build the library with -DIR_LIB_LOW_POWER=1"
+#endif
+
+const int IR_RECEIVER_PIN = 2;
+
+IRReceiver irReceiver;
+
+void setup() {
+  Serial.begin(115200);
+  if (!irReceiver.begin(IR_RECEIVER_PIN)) {
+    Serial.println("Error: IR Receiver initialization failed!");
+    while (1) delay(1000);
+  }
+}
+
+void loop() {
+  if (irReceiver.isCode()) {
+    DecodedIR result = irReceiver.getCode();
+    Serial.print(irReceiver.brandToString(result.brand));
+    Serial.print(" ");
+    Serial.println(irReceiver.getButtonName(result));
+  }
+
+  if (irReceiver.readyToSleep()) {
+    Serial.flush(); // The UART stops while asleep
+    if (irReceiver.sleepUntilIR() && irReceiver.getStats().wakeups > 0) {
+      Serial.print("Previous press kept the MCU awake for ");
+      Serial.print(irReceiver.getStats().lastWakeMicros);
+      Serial.println(" us");
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef IR_HOST_ARDUINO_H
+#define IR_HOST_ARDUINO_H
+
+// Minimal Arduino API for building the decoder on a desktop host. Time is a virtual clock
+// that the replay driver advances, so a capture decodes the same way on every run.
+// Put this directory first on the include path; nothing here is used on a real board.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // strcasecmp()
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define HEX 16
+#define DEC 10
+#define NOT_AN_INTERRUPT -1
+#define IR_LIB_HOST 1 // Tags binary captures with IR_PLATFORM_HOST
+
+typedef uint8_t byte;
+
+// --- Virtual Clock And Pin ---
+// Per thread, so each decoder thread of IRBatchDecode replays on its own clock.
+extern thread_local uint32_t g_hostMicros;
+extern thread_local int g_hostPinLevel;
+
+inline uint32_t micros() { return g_hostMicros; }
+// Counts on across micros() wrapping, as on a board, so long replays keep idle timeouts
+// working. Needs a call at least once per wrap of the clock, which any replay makes.
+inline unsigned long millis() {
+    static thread_local uint32_t lastMicros = 0;
+    static thread_local uint64_t wrappedMicros = 0;
+    if (g_hostMicros < lastMicros) wrappedMicros += 1ULL << 32;
+    lastMicros = g_hostMicros;
+    return (uint32_t)((wrappedMicros + g_hostMicros) / 1000);
+}
+inline void delay(unsigned long ms) { g_hostMicros += ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { g_hostMicros += us; }
+
+inline void pinMode(int, int) {}
+inline int digitalRead(int) { return g_hostPinLevel; }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {} // Edges are fed by replayTransition()
+inline void detachInterrupt(int) {}
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+// --- Serial And Stream ---
+class String {
+public:
+    String(int value) : m_text(std::to_string(value)) {}
+    String(const char* text) : m_text(text) {}
+    const char* c_str() const { return m_text.c_str(); }
+private:
+    std::string m_text;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* data, size_t length) {
+        size_t written = 0;
+        while (written < length && write(data[written]) == 1) written++;
+        return written;
+    }
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return _printf(base == HEX ? "%X" : "%d", value); }
+    size_t print(unsigned int value, int base = DEC) { return _printf(base == HEX ? "%X" : "%u", value); }
+    size_t print(long value, int base = DEC) { return _printf(base == HEX ? "%lX" : "%ld", value); }
+    size_t print(unsigned long value, int base = DEC) { return _printf(base == HEX ? "%lX" : "%lu", value); }
+    template<typename T> size_t println(T value) { return print(value) + println(); }
+    size_t println() { return print('\n'); }
+private:
+    template<typename T> size_t _printf(const char* format, T value) {
+        char text[24];
+        snprintf(text, sizeof(text), format, value);
+        return print(text);
+    }
+};
+
+class HostSerial : public Print {
+public:
+    size_t write(uint8_t value) override { return fputc(value, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+extern HostSerial Serial;
+
+// Stream over a file, e.g. for IRReceiver::loadRemotes() or setCaptureOutput()
+class Stream : public Print {
+public:
+    explicit Stream(FILE* file) : m_file(file) {}
+    int available() { return (m_file != nullptr && !feof(m_file)) ? 1 : 0; }
+    int read() { return (m_file != nullptr) ? fgetc(m_file) : -1; }
+    size_t write(uint8_t value) override { return (m_file != nullptr && fputc(value, m_file) != EOF) ? 1 : 0; }
+    size_t write(const uint8_t* data, size_t length) override { return m_file ? fwrite(data, 1, length, m_file) : 0; }
+    using Print::print;
+private:
+    FILE* m_file;
+};
+
+#endif // IR_HOST_ARDUINO_H
@@ -0,0 +1,78 @@
+#ifndef IR_HOST_CAPTURE_FILES_H
+#define IR_HOST_CAPTURE_FILES_H
+
+// Capture file readers shared by the host tools. A capture file is either binary, as written
+// by setCaptureOutput(), or text: mark/space durations in microseconds, starting with a mark,
+// separated by whitespace or commas, with '#' starting a comment.
+
+#include <Arduino.h>
+#include <IRReceiver.h>
+#include <vector>
+
+inline uint32_t readVarint(const std::vector<uint8_t>& data, size_t& pos) {
+    uint32_t value = 0;
+    for (int shift = 0; pos < data.size() && shift < 32; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return value;
+}
+
+// Binary captures (see IR_CAPTURE_FORMAT_VERSION), one burst per header.
+inline bool parseBinaryCaptures(const std::vector<uint8_t>& data, std::vector<std::vector<uint32_t>>& bursts) {
+    size_t pos = 0;
+    while (pos + IR_CAPTURE_HEADER_SIZE <= data.size()) {
+        if (data[pos] != 'I' || data[pos + 1] != 'R' || data[pos + 2] != 'C' || data[pos + 3] != IR_CAPTURE_FORMAT_VERSION) {
+            return false;
+        }
+        pos += IR_CAPTURE_HEADER_SIZE;
+        std::vector<uint32_t> durations;
+        uint32_t duration;
+        while (pos < data.size() && (duration = readVarint(data, pos)) != 0) {
+            durations.push_back(duration);
+        }
+        if (!durations.empty()) bursts.push_back(durations);
+    }
+    return pos == data.size();
+}
+
+// Text captures: durations separated by whitespace or commas, '#' comments. One burst per file.
+inline bool parseTextCapture(const std::vector<uint8_t>& data, std::vector<std::vector<uint32_t>>& bursts) {
+    std::vector<uint32_t> durations;
+    uint32_t value = 0;
+    bool inNumber = false, inComment = false;
+    for (size_t i = 0; i <= data.size(); i++) {
+        int c = (i < data.size()) ? data[i] : '\n';
+        if (c == '#') inComment = true;
+        if (c == '\n') inComment = false;
+        if (!inComment && c >= '0' && c <= '9') {
+            value = value * 10 + (uint32_t)(c - '0');
+            inNumber = true;
+        } else if (inNumber) {
+            durations.push_back(value);
+            value = 0;
+            inNumber = false;
+        }
+    }
+    if (durations.empty()) return false;
+    bursts.push_back(durations);
+    return true;
+}
+
+// Appends the bursts in a file. False when it cannot be read or holds no capture.
+inline bool readCaptureFile(const char* path, std::vector<std::vector<uint32_t>>& bursts) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = fgetc(file)) != EOF) data.push_back((uint8_t)c);
+    fclose(file);
+    if (data.size() >= 3 && data[0] == 'I' && data[1] == 'R' && data[2] == 'C') {
+        size_t before = bursts.size();
+        return parseBinaryCaptures(data, bursts) && bursts.size() > before;
+    }
+    return parseTextCapture(data, bursts);
+}
+
+#endif // IR_HOST_CAPTURE_FILES_H
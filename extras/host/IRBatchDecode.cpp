@@ -0,0 +1,232 @@
+// Multithreaded batch decoder for large capture corpora.
+//
+// Decodes every burst in a set of capture files with the same pipeline that runs on the board
+// and reports throughput and per-protocol results, e.g. to check a tolerance change against
+// thousands of recorded presses. Bursts are shared out between worker threads, each with its
+// own IRReceiver and its own virtual clock, so no decoder state is shared. Receivers are begun
+// with IR_CAPTURE_REPLAY, which takes no ISR slot, so there is one thread per core. From the
+// repository root:
+//
+//   g++ -std=gnu++11 -O2 -pthread -I extras/host -I . extras/host/IRBatchDecode.cpp *.cpp -o irbatch
+//   ./irbatch corpus.irc more.txt          # one thread per core
+//   ./irbatch -j 2 -l labels.txt corpus.irc
+//   ./irbatch -n 10000                     # the built-in reference captures, 10000 times each
+//
+// A labels file gives the expected code of each burst, in the order the bursts are read: one
+// line per burst of "BRAND [address [command]]" (numbers in C notation), "NONE" when no code
+// should be decoded, or "-" for an unlabeled burst. '#' starts a comment. Per-protocol accuracy
+// is reported for labeled bursts; the exit status is non-zero when any of them decodes wrongly.
+
+#include <Arduino.h>
+#include <IRReceiver.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../../examples/DecodeBenchmark/BenchCaptures.h"
+#include "CaptureFiles.h"
+
+thread_local uint32_t g_hostMicros = 1000000;
+thread_local int g_hostPinLevel = HIGH;
+HostSerial Serial;
+
+namespace {
+
+const int BATCH_PIN = 2;
+const uint32_t FRAME_GAP_US = 10000; // Spaces this long end a frame, as in the decoder
+
+struct Label {
+    bool present = false; // False for an unlabeled burst
+    RemoteBrand brand = UNKNOWN; // UNKNOWN expects no code
+    int address = -1; // -1 matches any
+    int command = -1;
+};
+
+struct BurstResult {
+    DecodedIR code; // First code decoded from the burst
+    int codes = 0;
+};
+
+// Replays one burst and lets the receiver go idle. Only the first code is kept; the rest of a
+// held burst is counted.
+BurstResult decodeBurst(IRReceiver& receiver, const std::vector<uint32_t>& durations) {
+    BurstResult result;
+    auto poll = [&](uint32_t now) {
+        g_hostMicros = now;
+        bool ready = receiver.isCode();
+        while (ready) {
+            DecodedIR code;
+            ready = receiver.getCodes(&code, 1) == 1;
+            if (ready && result.codes++ == 0) result.code = code;
+        }
+    };
+    uint32_t end = replayCapture(receiver, durations.data(), durations.size(), g_hostMicros, poll);
+    poll(end + (IR_LIB_IDLE_TIMEOUT_MS + 1) * 1000UL); // Idle timeout ends the burst
+    g_hostMicros += 10000; // Quiet time before the next burst
+    return result;
+}
+
+size_t countFrames(const std::vector<uint32_t>& durations) {
+    size_t frames = 1;
+    for (size_t i = 1; i + 1 < durations.size(); i += 2) {
+        if (durations[i] >= FRAME_GAP_US) frames++;
+    }
+    return frames;
+}
+
+bool parseBrand(const IRReceiver& receiver, const char* name, RemoteBrand& brand) {
+    if (strcasecmp(name, "NONE") == 0) {
+        brand = UNKNOWN;
+        return true;
+    }
+    for (int b = 0; b < NUM_BRANDS; b++) {
+        if (strcasecmp(name, receiver.brandToString((RemoteBrand)b)) == 0) {
+            brand = (RemoteBrand)b;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readLabels(const IRReceiver& receiver, const char* path, std::vector<Label>& labels) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) return false;
+    char line[128];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        char* comment = strchr(line, '#');
+        if (comment != nullptr) *comment = '\0';
+        char name[32];
+        char extra[2];
+        long address = -1, command = -1;
+        int fields = sscanf(line, "%31s %li %li %1s", name, &address, &command, extra);
+        if (fields <= 0) continue; // Blank or comment line
+        Label label;
+        if (strcmp(name, "-") != 0) {
+            label.present = true;
+            ok = fields <= 3 && parseBrand(receiver, name, label.brand);
+            label.address = (int)address;
+            label.command = (int)command;
+        }
+        labels.push_back(label);
+    }
+    fclose(file);
+    return ok;
+}
+
+bool matchesLabel(const Label& label, const BurstResult& result) {
+    if (label.brand == UNKNOWN) return result.codes == 0;
+    return result.codes > 0 && result.code.brand == label.brand && (label.address == -1 || result.code.address == label.address) &&
+           (label.command == -1 || result.code.command == label.command);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int threadCount = (int)std::thread::hardware_concurrency();
+    int iterations = 1000; // Only used for the built-in captures
+    const char* labelPath = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) labelPath = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (iterations < 1) iterations = 1;
+    if (threadCount < 1) threadCount = 1;
+
+    std::vector<std::unique_ptr<IRReceiver>> receivers;
+    for (int t = 0; t < threadCount; t++) {
+        receivers.emplace_back(new IRReceiver());
+        if (!receivers.back()->begin(BATCH_PIN, IR_CAPTURE_REPLAY)) {
+            fprintf(stderr, "begin() failed\n");
+            return 2;
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> bursts;
+    std::vector<Label> labels;
+    if (files.empty()) { // The built-in captures, which carry their own labels
+        uint32_t durations[IR_BENCH_MAX_DURATIONS];
+        for (size_t i = 0; i < BENCH_CASE_COUNT; i++) {
+            const BenchCase& bench = BENCH_CASES[i];
+            CaptureBuilder capture(durations, IR_BENCH_MAX_DURATIONS, 1 + (uint32_t)i);
+            bench.build(capture);
+            Label label;
+            label.present = true;
+            label.brand = bench.codes > 0 ? bench.brand : UNKNOWN;
+            label.address = bench.address;
+            label.command = bench.command;
+            for (int iter = 0; iter < iterations; iter++) {
+                bursts.emplace_back(durations, durations + capture.count());
+                labels.push_back(label);
+            }
+        }
+    }
+    for (const char* path : files) {
+        if (!readCaptureFile(path, bursts)) {
+            fprintf(stderr, "%s: no captures\n", path);
+            return 2;
+        }
+    }
+    if (labelPath != nullptr) {
+        if (!readLabels(*receivers[0], labelPath, labels)) {
+            fprintf(stderr, "%s: bad labels\n", labelPath);
+            return 2;
+        }
+        if (labels.size() != bursts.size()) {
+            fprintf(stderr, "%s: %zu labels for %zu bursts\n", labelPath, labels.size(), bursts.size());
+            return 2;
+        }
+    }
+    labels.resize(bursts.size());
+
+    // Workers take bursts in chunks, so long and short bursts even out across threads. Each
+    // writes only its own results, so nothing else needs locking.
+    const size_t CHUNK = 64;
+    std::vector<BurstResult> results(bursts.size());
+    std::atomic<size_t> next(0);
+    auto work = [&](IRReceiver* receiver) {
+        size_t first;
+        while ((first = next.fetch_add(CHUNK)) < bursts.size()) {
+            size_t last = std::min(first + CHUNK, bursts.size());
+            for (size_t b = first; b < last; b++) results[b] = decodeBurst(*receiver, bursts[b]);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) workers.emplace_back(work, receivers[t].get());
+    for (std::thread& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t frames = 0;
+    for (const std::vector<uint32_t>& burst : bursts) frames += countFrames(burst);
+    uint32_t decoded[NUM_BRANDS] = {}, labeled[NUM_BRANDS] = {}, correct[NUM_BRANDS] = {};
+    size_t wrong = 0;
+    for (size_t b = 0; b < bursts.size(); b++) {
+        const BurstResult& result = results[b];
+        decoded[result.codes > 0 ? result.code.brand : UNKNOWN]++;
+        if (!labels[b].present) continue;
+        labeled[labels[b].brand]++;
+        if (matchesLabel(labels[b], result)) correct[labels[b].brand]++;
+        else wrong++;
+    }
+
+    printf("%zu bursts, %zu frames on %d thread(s) in %.3f s: %.0f bursts/s, %.0f frames/s\n", bursts.size(), frames, threadCount,
+           seconds, bursts.size() / seconds, frames / seconds);
+    printf("%-12s %10s %10s %10s %9s\n", "protocol", "decoded", "labeled", "correct", "accuracy");
+    for (int b = 0; b < NUM_BRANDS; b++) {
+        if (decoded[b] == 0 && labeled[b] == 0) continue;
+        const char* name = (b == UNKNOWN) ? "NONE" : receivers[0]->brandToString((RemoteBrand)b);
+        printf("%-12s %10u %10u %10u", name, (unsigned)decoded[b], (unsigned)labeled[b], (unsigned)correct[b]);
+        if (labeled[b] > 0) printf(" %8.2f%%", 100.0 * correct[b] / labeled[b]);
+        printf("\n");
+    }
+    uint32_t checksumFailures = 0;
+    for (const std::unique_ptr<IRReceiver>& receiver : receivers) checksumFailures += receiver->getStats().checksumFailures;
+    printf("Checksum failures: %u, wrong codes: %zu\n", (unsigned)checksumFailures, wrong);
+    return wrong ? 1 : 0;
+}
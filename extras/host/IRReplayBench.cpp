@@ -0,0 +1,147 @@
+// Host replay harness and decode benchmark.
+//
+// Builds the library against the Arduino shim in this directory and replays captures through
+// the same ring buffer, frame analysis and scoring code that runs on the board. From the
+// repository root:
+//
+//   g++ -std=gnu++11 -O2 -I extras/host -I . extras/host/IRReplayBench.cpp *.cpp -o irbench
+//   ./irbench                 # built-in NEC/JVC/SONY/held/noise captures
+//   ./irbench -n 5000 a.txt   # more iterations, plus recorded captures
+//   ./irbench -o corpus.irc   # also write every replayed burst as a binary capture
+//
+// A capture file is either binary, as written by setCaptureOutput(), or text: mark/space
+// durations in microseconds, starting with a mark, separated by whitespace or commas, with
+// '#' starting a comment. The exit status is non-zero when a built-in
+// capture decodes to the wrong code, so the harness can gate changes to the decoder.
+
+#include <Arduino.h>
+#include <IRReceiver.h>
+#include <chrono>
+#include <vector>
+#include "../../examples/DecodeBenchmark/BenchCaptures.h"
+#include "CaptureFiles.h"
+
+thread_local uint32_t g_hostMicros = 1000000;
+thread_local int g_hostPinLevel = HIGH;
+HostSerial Serial;
+
+namespace {
+
+const int BENCH_PIN = 2;
+
+struct ReplayResult {
+    std::vector<DecodedIR> codes;
+    double decodeNanos = 0; // Time spent inside isCode()
+};
+
+// Replays one burst and lets the receiver go idle, timing every isCode() call.
+ReplayResult replayBurst(IRReceiver& receiver, const uint32_t durations[], size_t count) {
+    ReplayResult result;
+    auto poll = [&](uint32_t now) {
+        g_hostMicros = now;
+        auto start = std::chrono::steady_clock::now();
+        bool ready = receiver.isCode();
+        result.decodeNanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        while (ready) {
+            DecodedIR code;
+            ready = receiver.getCodes(&code, 1) == 1;
+            if (ready) result.codes.push_back(code);
+        }
+    };
+    uint32_t end = replayCapture(receiver, durations, count, g_hostMicros, poll);
+    poll(end + (IR_LIB_IDLE_TIMEOUT_MS + 1) * 1000UL); // Idle timeout ends the burst
+    g_hostMicros += 10000; // Quiet time before the next burst
+    return result;
+}
+
+void printCode(IRReceiver& receiver, const DecodedIR& code) {
+    printf(" %s addr=0x%X cmd=0x%X rep=%u", receiver.brandToString(code.brand), code.address, code.command, code.repeatCount);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = 1000;
+    std::vector<const char*> files;
+    const char* outputPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outputPath = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (iterations < 1) iterations = 1;
+
+    IRReceiver receiver;
+    if (!receiver.begin(BENCH_PIN)) {
+        fprintf(stderr, "begin() failed\n");
+        return 2;
+    }
+    FILE* outputFile = nullptr;
+    if (outputPath != nullptr && (outputFile = fopen(outputPath, "wb")) == nullptr) {
+        fprintf(stderr, "%s: cannot create\n", outputPath);
+        return 2;
+    }
+    Stream output(outputFile);
+
+    printf("%-12s %8s %10s  %s\n", "capture", "edges", "ns/burst", "result");
+    int failures = 0;
+    uint32_t durations[IR_BENCH_MAX_DURATIONS];
+    for (size_t i = 0; i < BENCH_CASE_COUNT; i++) {
+        const BenchCase& bench = BENCH_CASES[i];
+        CaptureBuilder capture(durations, IR_BENCH_MAX_DURATIONS, 1 + (uint32_t)i);
+        bench.build(capture);
+
+        double totalNanos = 0;
+        int wrong = 0;
+        ReplayResult last;
+        for (int iter = 0; iter < iterations; iter++) {
+            receiver.setCaptureOutput((outputFile != nullptr && iter == 0) ? &output : nullptr); // Record each capture once
+            last = replayBurst(receiver, durations, capture.count());
+            totalNanos += last.decodeNanos;
+            bool ok = (int)last.codes.size() == bench.codes;
+            if (ok && bench.codes > 0) {
+                const DecodedIR& code = last.codes[0];
+                ok = code.brand == bench.brand && code.address == bench.address && code.command == bench.command;
+            }
+            if (!ok) wrong++;
+        }
+        printf("%-12s %8zu %10.0f  %s (%d/%d)", bench.name, capture.count() + 1, totalNanos / iterations,
+               wrong ? "FAIL" : "ok", iterations - wrong, iterations);
+        for (const DecodedIR& code : last.codes) printCode(receiver, code);
+        printf("\n");
+        if (wrong) failures++;
+    }
+
+    for (const char* path : files) {
+        std::vector<std::vector<uint32_t>> bursts;
+        if (!readCaptureFile(path, bursts)) {
+            fprintf(stderr, "%s: no captures\n", path);
+            failures++;
+            continue;
+        }
+        for (size_t b = 0; b < bursts.size(); b++) {
+            const std::vector<uint32_t>& recorded = bursts[b];
+            double totalNanos = 0;
+            ReplayResult last;
+            for (int iter = 0; iter < iterations; iter++) {
+                receiver.setCaptureOutput((outputFile != nullptr && iter == 0) ? &output : nullptr);
+                last = replayBurst(receiver, recorded.data(), recorded.size());
+                totalNanos += last.decodeNanos;
+            }
+            printf("%s#%zu %8zu %10.0f  %zu code(s)", path, b, recorded.size() + 1, totalNanos / iterations, last.codes.size());
+            for (const DecodedIR& code : last.codes) printCode(receiver, code);
+            printf("\n");
+        }
+    }
+    receiver.setCaptureOutput(nullptr);
+    if (outputFile != nullptr) fclose(outputFile);
+    IRStats stats = receiver.getStats();
+    printf("Edges: %lu captured, %lu dropped, %lu glitches filtered, peak ring fill %u of %u\n", (unsigned long)stats.edgesCaptured,
+           (unsigned long)stats.edgesDropped, (unsigned long)stats.glitchesFiltered, (unsigned)stats.peakRingFill,
+           (unsigned)(IR_LIB_MAX_TRANSITIONS - 1));
+    printf("Bursts: %lu analyzed, %lu undecoded, %u checksum failures, %lu early dispatch passes, %lu noise passes\n",
+           (unsigned long)stats.burstsAnalyzed, (unsigned long)stats.burstsUndecoded, (unsigned)stats.checksumFailures,
+           (unsigned long)stats.fastPathPasses, (unsigned long)stats.noisePasses);
+    printf("Overflows: %u\n", (unsigned)receiver.getOverflowCount());
+    return failures ? 1 : 0;
+}